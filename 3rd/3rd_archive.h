@@ -14,6 +14,88 @@
 #define DIR_C
 #endif // ARCHIVE_C
 
+// entryname -> index hashtables and positional reads, shared by zip/tar/pak.
+// hashtables are built while archives are opened or appended. inserting a name again takes over its slot, so latest duplicate wins.
+// extractors read at explicit offsets and never seek the FILE*, so many threads can extract from the same (r)ead archive at once.
+
+#if defined ZIP_C || defined TAR_C || defined PAK_C
+#ifndef ARCHIVE_INDEX_C
+#define ARCHIVE_INDEX_C
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <errno.h>
+#include <stdio.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifndef REALLOC
+#define REALLOC realloc
+#endif
+
+static int archive__pread(FILE *fp, void *buf, size_t len, uint64_t offset) { // 1 if all len bytes were read
+    for( char *ptr = (char*)buf; len; ) {
+#ifdef _WIN32
+        OVERLAPPED ov = {0};
+        ov.Offset = (DWORD)offset, ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD got = 0, chunk = len < (1u << 30) ? (DWORD)len : (1u << 30);
+        if( !ReadFile((HANDLE)_get_osfhandle(_fileno(fp)), ptr, chunk, &got, &ov) || !got ) return 0;
+#else
+        ssize_t got = pread(fileno(fp), ptr, len, (off_t)offset);
+        if( got < 0 && errno == EINTR ) continue;
+        if( got <= 0 ) return 0;
+#endif
+        ptr += got, len -= got, offset += got;
+    }
+    return 1;
+}
+
+typedef struct archive_index {
+    unsigned *slots; // entry index +1, 0 if empty slot
+    unsigned cap, used;
+} archive_index;
+
+typedef const char *(*archive_namefn)(void *archive, unsigned index);
+
+static uint32_t archive__hash(const char *name) { // fnv1a
+    uint32_t hash = 2166136261u;
+    while( *name ) hash = ( (unsigned char)*name++ ^ hash ) * 16777619u;
+    return hash;
+}
+static void archive__index_put(archive_index *ix, unsigned index, archive_namefn name, void *archive) {
+    if( (ix->used + 1) * 2 > ix->cap ) { // keep load factor under 50%
+        archive_index grown = { 0, ix->cap ? ix->cap * 2 : 64, 0 };
+        grown.slots = (unsigned*)REALLOC(0, grown.cap * sizeof(unsigned));
+        memset(grown.slots, 0, grown.cap * sizeof(unsigned));
+        for( unsigned i = 0; i < ix->cap; ++i ) if( ix->slots[i] ) archive__index_put(&grown, ix->slots[i] - 1, name, archive);
+        if( ix->slots ) REALLOC(ix->slots, 0);
+        *ix = grown;
+    }
+    const char *key = name(archive, index);
+    for( unsigned mask = ix->cap - 1, i = archive__hash(key) & mask; ; i = (i + 1) & mask ) {
+        if( !ix->slots[i] ) { ix->slots[i] = index + 1; ix->used++; return; }
+        if( !strcmp(key, name(archive, ix->slots[i] - 1)) ) { ix->slots[i] = index + 1; return; }
+    }
+}
+static int archive__index_find(const archive_index *ix, const char *key, archive_namefn name, void *archive) {
+    if( ix->cap ) for( unsigned mask = ix->cap - 1, i = archive__hash(key) & mask; ix->slots[i]; i = (i + 1) & mask ) {
+        if( !strcmp(key, name(archive, ix->slots[i] - 1)) ) return ix->slots[i] - 1;
+    }
+    return -1;
+}
+static void archive__index_free(archive_index *ix) {
+    if( ix->slots ) REALLOC(ix->slots, 0);
+    ix->slots = 0, ix->cap = ix->used = 0;
+}
+
+#endif // ARCHIVE_INDEX_C
+#endif
+
 //#line 1 "src/zip.c"
 // zip un/packer. based on JUnzip library by Joonas Pihlajamaa (UNLICENSE)
 // - rlyeh, public domain.
@@ -37,6 +119,7 @@ zip* zip_open(const char *file, const char *mode /*r,w,a*/);
 
     // only for (w)rite or (a)ppend mode
     bool zip_append_file(zip*, const char *entryname, const char *comment, FILE *in, unsigned compr_level);
+    bool zip_append_raw(zip*, zip *src, unsigned index); // copies entry from a (r)ead archive as is: no recompression, same stamp, crc and comment
 
     // only for (r)ead mode
     int zip_find(zip*, const char *entryname); // convert entry to index. returns <0 if not found.
@@ -53,6 +136,7 @@ zip* zip_open(const char *file, const char *mode /*r,w,a*/);
         void*    zip_extract(zip*, unsigned index); // must free() after use
         bool     zip_extract_file(zip*, unsigned index, FILE *out);
         unsigned zip_extract_data(zip*, unsigned index, void *out, unsigned outlen);
+        const void* zip_peek(zip*, unsigned index); // zero-copy view of a stored (level 0) entry, if archive is memory-mapped. NULL otherwise. valid until zip_close()
 
 void zip_close(zip*);
 
@@ -381,16 +465,89 @@ struct zip {
     char *comment;
     } *entries;
     unsigned count;
+    archive_index index;
+    const char *map; // whole archive, if memory-mapped in (r)ead mode
+    size_t maplen;
 };
 
+static const char *zip__entryname(void *z, unsigned index) {
+    return ((zip*)z)->entries[index].filename;
+}
+
+// zip mmap. read-only mappings; disable with -DZIP_NO_MMAP
+
+#ifndef ZIP_NO_MMAP
+#  ifdef _WIN32
+#  include <windows.h>
+#  else
+#  include <sys/mman.h>
+#  endif
+#endif
+
+static const char *zip__mmap(FILE *fp, size_t len) {
+#ifndef ZIP_NO_MMAP
+    if( !len ) return 0;
+#  ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA((HANDLE)_get_osfhandle(_fileno(fp)), NULL, PAGE_READONLY, 0, 0, NULL);
+    if( !mapping ) return 0;
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, len);
+    CloseHandle(mapping); // view keeps the mapping alive
+    return (const char *)view;
+#  else
+    void *view = mmap(0, len, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    return view == MAP_FAILED ? 0 : (const char *)view;
+#  endif
+#else
+    return 0;
+#endif
+}
+static void zip__munmap(const char *map, size_t len) {
+#ifndef ZIP_NO_MMAP
+#  ifdef _WIN32
+    if( map ) UnmapViewOfFile(map);
+#  else
+    if( map ) munmap((void*)map, len);
+#  endif
+#endif
+}
+
 uint32_t zip__crc32(uint32_t crc, const void *data, size_t n_bytes) {
     // CRC32 routine is from Björn Samuelsson's public domain implementation at http://home.thep.lu.se/~bjorn/crc/
-    static uint32_t table[256] = {0};
-    if(!*table) for(uint32_t i = 0; i < 0x100; ++i) {
-        uint32_t r = i;
-        for(int j = 0; j < 8; ++j) r = (r & 1 ? 0 : (uint32_t)0xEDB88320L) ^ r >> 1;
-        table[i] = r ^ (uint32_t)0xFF000000L;
-    }
+    // table[i] = r ^ 0xFF000000, where r = i after 8 rounds of: r = (r & 1 ? 0 : 0xEDB88320) ^ r >> 1
+    static const uint32_t table[256] = {
+        0xD202EF8D, 0xA505DF1B, 0x3C0C8EA1, 0x4B0BBE37, 0xD56F2B94, 0xA2681B02, 0x3B614AB8, 0x4C667A2E,
+        0xDCD967BF, 0xABDE5729, 0x32D70693, 0x45D03605, 0xDBB4A3A6, 0xACB39330, 0x35BAC28A, 0x42BDF21C,
+        0xCFB5FFE9, 0xB8B2CF7F, 0x21BB9EC5, 0x56BCAE53, 0xC8D83BF0, 0xBFDF0B66, 0x26D65ADC, 0x51D16A4A,
+        0xC16E77DB, 0xB669474D, 0x2F6016F7, 0x58672661, 0xC603B3C2, 0xB1048354, 0x280DD2EE, 0x5F0AE278,
+        0xE96CCF45, 0x9E6BFFD3, 0x0762AE69, 0x70659EFF, 0xEE010B5C, 0x99063BCA, 0x000F6A70, 0x77085AE6,
+        0xE7B74777, 0x90B077E1, 0x09B9265B, 0x7EBE16CD, 0xE0DA836E, 0x97DDB3F8, 0x0ED4E242, 0x79D3D2D4,
+        0xF4DBDF21, 0x83DCEFB7, 0x1AD5BE0D, 0x6DD28E9B, 0xF3B61B38, 0x84B12BAE, 0x1DB87A14, 0x6ABF4A82,
+        0xFA005713, 0x8D076785, 0x140E363F, 0x630906A9, 0xFD6D930A, 0x8A6AA39C, 0x1363F226, 0x6464C2B0,
+        0xA4DEAE1D, 0xD3D99E8B, 0x4AD0CF31, 0x3DD7FFA7, 0xA3B36A04, 0xD4B45A92, 0x4DBD0B28, 0x3ABA3BBE,
+        0xAA05262F, 0xDD0216B9, 0x440B4703, 0x330C7795, 0xAD68E236, 0xDA6FD2A0, 0x4366831A, 0x3461B38C,
+        0xB969BE79, 0xCE6E8EEF, 0x5767DF55, 0x2060EFC3, 0xBE047A60, 0xC9034AF6, 0x500A1B4C, 0x270D2BDA,
+        0xB7B2364B, 0xC0B506DD, 0x59BC5767, 0x2EBB67F1, 0xB0DFF252, 0xC7D8C2C4, 0x5ED1937E, 0x29D6A3E8,
+        0x9FB08ED5, 0xE8B7BE43, 0x71BEEFF9, 0x06B9DF6F, 0x98DD4ACC, 0xEFDA7A5A, 0x76D32BE0, 0x01D41B76,
+        0x916B06E7, 0xE66C3671, 0x7F6567CB, 0x0862575D, 0x9606C2FE, 0xE101F268, 0x7808A3D2, 0x0F0F9344,
+        0x82079EB1, 0xF500AE27, 0x6C09FF9D, 0x1B0ECF0B, 0x856A5AA8, 0xF26D6A3E, 0x6B643B84, 0x1C630B12,
+        0x8CDC1683, 0xFBDB2615, 0x62D277AF, 0x15D54739, 0x8BB1D29A, 0xFCB6E20C, 0x65BFB3B6, 0x12B88320,
+        0x3FBA6CAD, 0x48BD5C3B, 0xD1B40D81, 0xA6B33D17, 0x38D7A8B4, 0x4FD09822, 0xD6D9C998, 0xA1DEF90E,
+        0x3161E49F, 0x4666D409, 0xDF6F85B3, 0xA868B525, 0x360C2086, 0x410B1010, 0xD80241AA, 0xAF05713C,
+        0x220D7CC9, 0x550A4C5F, 0xCC031DE5, 0xBB042D73, 0x2560B8D0, 0x52678846, 0xCB6ED9FC, 0xBC69E96A,
+        0x2CD6F4FB, 0x5BD1C46D, 0xC2D895D7, 0xB5DFA541, 0x2BBB30E2, 0x5CBC0074, 0xC5B551CE, 0xB2B26158,
+        0x04D44C65, 0x73D37CF3, 0xEADA2D49, 0x9DDD1DDF, 0x03B9887C, 0x74BEB8EA, 0xEDB7E950, 0x9AB0D9C6,
+        0x0A0FC457, 0x7D08F4C1, 0xE401A57B, 0x930695ED, 0x0D62004E, 0x7A6530D8, 0xE36C6162, 0x946B51F4,
+        0x19635C01, 0x6E646C97, 0xF76D3D2D, 0x806A0DBB, 0x1E0E9818, 0x6909A88E, 0xF000F934, 0x8707C9A2,
+        0x17B8D433, 0x60BFE4A5, 0xF9B6B51F, 0x8EB18589, 0x10D5102A, 0x67D220BC, 0xFEDB7106, 0x89DC4190,
+        0x49662D3D, 0x3E611DAB, 0xA7684C11, 0xD06F7C87, 0x4E0BE924, 0x390CD9B2, 0xA0058808, 0xD702B89E,
+        0x47BDA50F, 0x30BA9599, 0xA9B3C423, 0xDEB4F4B5, 0x40D06116, 0x37D75180, 0xAEDE003A, 0xD9D930AC,
+        0x54D13D59, 0x23D60DCF, 0xBADF5C75, 0xCDD86CE3, 0x53BCF940, 0x24BBC9D6, 0xBDB2986C, 0xCAB5A8FA,
+        0x5A0AB56B, 0x2D0D85FD, 0xB404D447, 0xC303E4D1, 0x5D677172, 0x2A6041E4, 0xB369105E, 0xC46E20C8,
+        0x72080DF5, 0x050F3D63, 0x9C066CD9, 0xEB015C4F, 0x7565C9EC, 0x0262F97A, 0x9B6BA8C0, 0xEC6C9856,
+        0x7CD385C7, 0x0BD4B551, 0x92DDE4EB, 0xE5DAD47D, 0x7BBE41DE, 0x0CB97148, 0x95B020F2, 0xE2B71064,
+        0x6FBF1D91, 0x18B82D07, 0x81B17CBD, 0xF6B64C2B, 0x68D2D988, 0x1FD5E91E, 0x86DCB8A4, 0xF1DB8832,
+        0x616495A3, 0x1663A535, 0x8F6AF48F, 0xF86DC419, 0x660951BA, 0x110E612C, 0x88073096, 0xFF000000,
+    };
     for(size_t i = 0; i < n_bytes; ++i) {
         crc = table[(uint8_t)crc ^ ((uint8_t*)data)[i]] ^ crc >> 8;
     }
@@ -409,6 +566,7 @@ int zip__callback(FILE *fp, int idx, JZGlobalFileHeader *header, char *filename,
     e->extra = REALLOC(0, header->extraFieldLength);
     memcpy(e->extra, extra, header->extraFieldLength);
     e->comment = STRDUP(comment);
+    archive__index_put(&z->index, index, zip__entryname, z);
 
     snprintf(e->timestamp, sizeof(e->timestamp), "%04d/%02d/%02d %02d:%02d:%02d" "%c" "%04d%02d%02d%02d%02d%02d",
         JZYEAR(header->lastModFileDate), JZMONTH(header->lastModFileDate), JZDAY(header->lastModFileDate),
@@ -426,12 +584,8 @@ int zip__callback(FILE *fp, int idx, JZGlobalFileHeader *header, char *filename,
 int ZIP_DEBUG = 0;
 
 int zip_find(zip *z, const char *entryname) {
-    int zip_debug = ZIP_DEBUG; ZIP_DEBUG = 0;
-    if(zip_debug) PRINTF("zip_find(%s)\n", entryname);
-    if( z->in ) for( int i = z->count; --i >= 0; ) { // in case of several copies, grab most recent file (last coincidence)
-        if(zip_debug) PRINTF("\t%d) %s\n", i, z->entries[i].filename);
-        if( 0 == strcmp(entryname, z->entries[i].filename)) return i;
-    }
+    if(ZIP_DEBUG) ZIP_DEBUG = 0, PRINTF("zip_find(%s)\n", entryname); // one-shot. written only when set, as finds run concurrently
+    if( z->in ) return archive__index_find(&z->index, entryname, zip__entryname, z); // in case of several copies, most recent file (last coincidence) is indexed
     return -1;
 }
 
@@ -479,13 +633,38 @@ unsigned zip_codec(zip *z, unsigned index) {
     return 0;
 }
 
+const void* zip_peek(zip *z, unsigned index) {
+    if( z->in && z->map && index < z->count ) {
+        JZGlobalFileHeader *header = &(z->entries[index].header);
+        if( header->compressionMethod == 0 && z->entries[index].offset + header->uncompressedSize <= z->maplen ) {
+            return z->map + z->entries[index].offset;
+        }
+    }
+    return NULL;
+}
+
 unsigned zip_extract_data(zip* z, unsigned index, void *out, unsigned outlen) {
     if( z->in && index < z->count ) {
         JZGlobalFileHeader *header = &(z->entries[index].header);
         if( outlen <= header->uncompressedSize ) {
-            fseek(z->in, z->entries[index].offset, SEEK_SET);
-            int ret = jzReadData(z->in, header, (char*)out);
-            return ret == JZ_OK ? header->uncompressedSize : 0;
+            if( z->map && z->entries[index].offset + header->compressedSize <= z->maplen ) {
+                // read/decompress straight from mapping
+                const char *in = z->map + z->entries[index].offset;
+                if( header->compressionMethod == 0 ) return memcpy(out, in, header->uncompressedSize), header->uncompressedSize;
+                if( (header->compressionMethod & 255) != 8 ) return 0;
+                unsigned ret = DECOMPRESS((void*)in, header->compressedSize, out, header->uncompressedSize, header->compressionMethod >> 8);
+                return ret ? header->uncompressedSize : 0;
+            }
+            // positional reads otherwise. the FILE* is shared, so it is never seeked
+            if( header->compressionMethod == 0 ) {
+                return archive__pread(z->in, out, header->uncompressedSize, z->entries[index].offset) ? header->uncompressedSize : 0;
+            }
+            if( (header->compressionMethod & 255) != 8 ) return 0;
+            void *in = REALLOC(0, header->compressedSize);
+            unsigned ret = in && archive__pread(z->in, in, header->compressedSize, z->entries[index].offset);
+            ret = ret && DECOMPRESS(in, header->compressedSize, out, header->uncompressedSize, header->compressionMethod >> 8);
+            REALLOC(in, 0);
+            return ret ? header->uncompressedSize : 0;
         }
     }
     return 0;
@@ -527,9 +706,13 @@ bool zip_append_file(zip *z, const char *entryname, const char *comment, FILE *i
     if( !entryname ) return ERR(false, "No filename provided");
 
     struct stat st;
-    struct tm *timeinfo;
+    struct tm tm, *timeinfo = &tm; // reentrant, as archives may be written from several threads
     stat(entryname, &st);
-    timeinfo = localtime(&st.st_mtime);
+#ifdef _WIN32
+    localtime_s(timeinfo, &st.st_mtime);
+#else
+    localtime_r(&st.st_mtime, timeinfo);
+#endif
 
     uint32_t crc = 0;
     unsigned char buf[1<<15];
@@ -544,6 +727,7 @@ bool zip_append_file(zip *z, const char *entryname, const char *comment, FILE *i
     *e = zero;
     e->filename = STRDUP(entryname);
     e->comment = comment ? STRDUP(comment) : 0;
+    archive__index_put(&z->index, index, zip__entryname, z);
 
     e->header.signature = 0x02014B50;
     e->header.versionMadeBy = 10; // random stuff
@@ -620,6 +804,46 @@ common:;
     return true;
 }
 
+bool zip_append_raw(zip *z, zip *src, unsigned index) {
+    if( !z->out ) return ERR(false, "No output archive");
+    if( !src->in || index >= src->count ) return ERR(false, "No input entry provided");
+
+    struct zip_entry *from = &src->entries[index];
+    unsigned datalen = from->header.compressedSize;
+
+    unsigned slot = z->count;
+    z->entries = REALLOC(z->entries, (++z->count) * sizeof(struct zip_entry));
+    if(z->entries == NULL) return ERR(false, "Failed to allocate new entry!");
+
+    struct zip_entry *e = &z->entries[slot], zero = {0};
+    *e = zero;
+    e->header = from->header;
+    e->filename = STRDUP(from->filename);
+    e->comment = from->comment ? STRDUP(from->comment) : 0;
+    archive__index_put(&z->index, slot, zip__entryname, z);
+
+    e->header.extraFieldLength = 0; // extra fields are not carried over
+    e->header.fileCommentLength = e->comment ? strlen(e->comment) : 0;
+    e->header.relativeOffsetOflocalHeader = ftell(z->out);
+
+    // write local header and filename, as zip_append_file() does
+    uint32_t signature = 0x04034B50;
+    fwrite(&signature, 1, sizeof(signature), z->out);
+    fwrite(&(e->header.versionNeededToExtract), 1, sizeof_JZLocalFileHeader - sizeof(signature), z->out);
+    fwrite(e->filename, 1, e->header.fileNameLength, z->out);
+
+    // copy blob, from mapping if available
+    if( src->map && from->offset + datalen <= src->maplen ) {
+        return fwrite(src->map + from->offset, 1, datalen, z->out) == datalen;
+    }
+    unsigned char buf[1<<15];
+    for( unsigned done = 0, bytes; done < datalen; done += bytes ) { // positional reads: src may be extracted from other threads
+        bytes = datalen - done < sizeof(buf) ? datalen - done : (unsigned)sizeof(buf);
+        if( !archive__pread(src->in, buf, bytes, (uint64_t)from->offset + done) || fwrite(buf, 1, bytes, z->out) != bytes ) return ERR(false, "Failed to copy entry %s", e->filename);
+    }
+    return true;
+}
+
 // zip common
 
 zip* zip_open(const char *file, const char *mode /*r,w,a*/) {
@@ -646,6 +870,10 @@ zip* zip_open(const char *file, const char *mode /*r,w,a*/) {
             REALLOC(z, 0);
             return fclose(fp), ERR(NULL, "Couldn't read ZIP file central directory.");
         }
+        if( mode[0] == 'r' ) {
+            z->maplen = (size_t)buffer.st_size;
+            z->map = zip__mmap(fp, z->maplen);
+        }
         if( mode[0] == 'a' ) {
 
             // resize (by truncation)
@@ -697,6 +925,7 @@ void zip_close(zip* z) {
     }
     if( z->out ) fclose(z->out);
     if( z->in ) fclose(z->in);
+    zip__munmap(z->map, z->maplen);
     // clean up
     for(unsigned i = 0; i < z->count; ++i ) {
         REALLOC(z->entries[i].filename, 0);
@@ -704,6 +933,7 @@ void zip_close(zip* z) {
         if(z->entries[i].comment) REALLOC(z->entries[i].comment, 0);
     }
     if(z->entries) REALLOC(z->entries, 0);
+    archive__index_free(&z->index);
     zip zero = {0}; *z = zero; REALLOC(z, 0);
 }
 
@@ -760,8 +990,13 @@ struct tar {
     unsigned size;
     size_t offset;
     } *entries;
+    archive_index index;
 };
 
+static const char *tar__entryname(void *t, unsigned index) {
+    return ((tar*)t)->entries[index].filename;
+}
+
 // equivalent to sscanf(buf, 8, "%.7o", &size); or (12, "%.11o", &modtime)
 // ignores everything after first null or space, including trailing bytes
 uint64_t tar__octal( const char *src, const char *eof ) {
@@ -784,6 +1019,7 @@ int tar__push_entry(const char *filename, unsigned inlen, size_t offset, void *u
     e->filename = STRDUP(filename);
     e->size = inlen;
     e->offset = offset;
+    archive__index_put(&t->index, index, tar__entryname, t);
 
     return 1;
 }
@@ -850,13 +1086,12 @@ tar *tar_open(const char *filename, const char *mode) {
     *t = zero;
     t->in = in;
     tar__parse(in, tar__push_entry, t);
+    if( !t->count ) { tar_close(t); return ERR(NULL, "not a tar file '%s'", filename); } // so other archivers get a chance
     return t;
 }
 
 int tar_find(tar *t, const char *entryname) {
-    if( t->in ) for( int i = t->count; --i >= 0; ) { // in case of several copies, grab most recent file (last coincidence)
-        if( 0 == strcmp(entryname, t->entries[i].filename)) return i;
-    }
+    if( t->in ) return archive__index_find(&t->index, entryname, tar__entryname, t); // in case of several copies, most recent file (last coincidence) is indexed
     return -1;
 }
 
@@ -878,10 +1113,9 @@ unsigned tar_offset(tar *t, unsigned index) {
 
 void *tar_extract(tar *t, unsigned index) {
     if( t && index < t->count ) {
-        fseek(t->in, t->entries[index].offset, SEEK_SET);
         size_t len = t->entries[index].size;
-        void *data = REALLOC(0, t->entries[index].size);
-        fread(data, 1, len, t->in);
+        void *data = REALLOC(0, len);
+        if( !archive__pread(t->in, data, len, t->entries[index].offset) ) REALLOC(data, 0), data = 0;
         return data;
     }
     return 0;
@@ -892,6 +1126,8 @@ void tar_close(tar *t) {
     for( int i = 0; i < t->count; ++i) {
         REALLOC(t->entries[i].filename, 0);
     }
+    if( t->entries ) REALLOC(t->entries, 0);
+    archive__index_free(&t->index);
     tar zero = {0};
     *t = zero;
     REALLOC(t, 0);
@@ -1011,8 +1247,13 @@ typedef struct pak {
     int dummy;
     pak_file *entries;
     unsigned count;
+    archive_index index;
 } pak;
 
+static const char *pak__entryname(void *p, unsigned index) {
+    return ((pak*)p)->entries[index].name;
+}
+
 pak *pak_open(const char *fname, const char *mode) {
     struct stat buffer;
     int exists = (stat(fname, &buffer) == 0);
@@ -1057,6 +1298,8 @@ pak *pak_open(const char *fname, const char *mode) {
             pak_file *e = &p->entries[i];
             e->offset = ltoh32(e->offset);
             e->size = ltoh32(e->size);
+            e->name[55] = '\0';
+            archive__index_put(&p->index, i, pak__entryname, p);
         }
 
         if( mode[0] == 'a' ) {
@@ -1112,6 +1355,7 @@ int pak_append_data(pak *p, const char *filename, const void *in, unsigned inlen
     snprintf(e->name, 55, "%s", filename); // @todo: verify 56 chars limit
     e->size = inlen;
     e->offset = ftell(p->out);
+    archive__index_put(&p->index, index, pak__entryname, p);
 
     // write blob
     fwrite(in, 1, inlen, p->out);
@@ -1127,6 +1371,7 @@ int pak_append_file(pak *p, const char *filename, FILE *in) {
     *e = zero;
     snprintf(e->name, 55, "%s", filename); // @todo: verify 56 chars limit
     e->offset = ftell(p->out);
+    archive__index_put(&p->index, index, pak__entryname, p);
 
     char buf[1<<15];
     while(!feof(in) && !ferror(in)) {
@@ -1173,6 +1418,7 @@ void pak_close(pak *p) {
         pak_file *e = &p->entries[i];
     }
     REALLOC(p->entries, 0);
+    archive__index_free(&p->index);
 
     // delete
     pak zero = {0};
@@ -1182,9 +1428,7 @@ void pak_close(pak *p) {
 
 int pak_find(pak *p, const char *filename) {
     if( p->in ) {
-        for( int i = p->count; --i >= 0; ) {
-            if(!strcmp(p->entries[i].name, filename)) return i;
-        }
+        return archive__index_find(&p->index, filename, pak__entryname, p);
     }
     return -1;
 }
@@ -1208,14 +1452,11 @@ char *pak_name(pak *p, unsigned index) {
 void *pak_extract(pak *p, unsigned index) {
     if( p->in && index < p->count ) {
         pak_file *e = &p->entries[index];
-        if( fseek(p->in, e->offset, SEEK_SET) != 0 ) {
-            return ERR(NULL, "cant seek");
-        }
         void *buffer = REALLOC(0, e->size);
         if( !buffer ) {
             return ERR(NULL, "out of mem");
         }
-        if( fread(buffer, 1, e->size, p->in) != e->size ) {
+        if( !archive__pread(p->in, buffer, e->size, e->offset) ) {
             REALLOC(buffer, 0);
             return ERR(NULL, "cant read");
         }
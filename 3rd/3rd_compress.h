@@ -3039,8 +3039,8 @@ static inline int get_penalty(int a, int b) {
 }
 
 static size_t crush_compress(const uint8_t* buf, size_t size, uint8_t* outbuf, size_t outlen, size_t level) {
-    static int head[HASH1_SIZE+HASH2_SIZE];
-    static int prev[W_SIZE];
+    int *head = REALLOC(0, sizeof(int) * (HASH1_SIZE+HASH2_SIZE)); // per call, so concurrent compressors do not share tables
+    int *prev = REALLOC(0, sizeof(int) * W_SIZE);
 
     //const int max_chain[]={4, 256, 1<<12}; // original [0fast..2uber]
     const int max_chain[11] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 1<<12 }; //[0fastest..10uber]
@@ -3210,6 +3210,8 @@ static size_t crush_compress(const uint8_t* buf, size_t size, uint8_t* outbuf, s
         bits_flush(&bits);
     }
 
+    REALLOC(head, 0);
+    REALLOC(prev, 0);
     return bits.g_outbuf_pos;
 }
 
@@ -4985,8 +4987,8 @@ unsigned lz4x_excess(unsigned flags);
 
 int lz4x_compress_optimal(const uint8_t *in, size_t inlen, uint8_t *out, size_t outlen)
 {
-    static int head[LZ4X_HASH_SIZE];
-    static int nodes[LZ4X_WINDOW_SIZE][2];
+    int *head = (int*)LZ4X_REALLOC(0, sizeof(int) * LZ4X_HASH_SIZE); // per call, so concurrent compressors do not share tables
+    int (*nodes)[2] = (int(*)[2])LZ4X_REALLOC(0, sizeof(int[2]) * LZ4X_WINDOW_SIZE);
     struct lz4x_path
     {
         int cum;
@@ -5190,6 +5192,8 @@ int lz4x_compress_optimal(const uint8_t *in, size_t inlen, uint8_t *out, size_t
     }
 
     LZ4X_REALLOC(path, 0);
+    LZ4X_REALLOC(nodes, 0);
+    LZ4X_REALLOC(head, 0);
 
     const int comp_len=op;
     return comp_len;
@@ -5197,8 +5201,8 @@ int lz4x_compress_optimal(const uint8_t *in, size_t inlen, uint8_t *out, size_t
 
 int lz4x_compress(const uint8_t *in, size_t inlen, uint8_t *out, size_t outlen, unsigned max_chain)
 {
-    static int head[LZ4X_HASH_SIZE];
-    static int tail[LZ4X_WINDOW_SIZE];
+    int *head = (int*)LZ4X_REALLOC(0, sizeof(int) * LZ4X_HASH_SIZE); // per call, so concurrent compressors do not share tables
+    int *tail = (int*)LZ4X_REALLOC(0, sizeof(int) * LZ4X_WINDOW_SIZE);
 
     int n = (int)inlen;
 
@@ -5319,6 +5323,9 @@ int lz4x_compress(const uint8_t *in, size_t inlen, uint8_t *out, size_t outlen,
         op+=run;
     }
 
+    LZ4X_REALLOC(tail, 0);
+    LZ4X_REALLOC(head, 0);
+
     const int comp_len=op;
     return comp_len;
 }
@@ -1,4 +1,4 @@
-// data structures and utils: array, map, set, string, hash, sort.
+// data structures and utils: array, map, set, string, hash, sort, intern.
 // - rlyeh, public domain
 
 #ifdef DS_C
@@ -9,6 +9,8 @@
 #define STRING_C
 #define LESS_C
 #define SET_C
+#define INTERN_C
+#define SORT_C
 #endif
 
 #ifndef DS_H
@@ -75,9 +77,12 @@
 #ifndef STRING_H
 #define STRING_H
 
-// string: temporary api (stack)
+// string: temporary api (per-thread arena; grows on demand, recycled at stringf_reset())
 char*   stringf(const char *fmt, ...);
 #define stringf(...) (printf || printf(__VA_ARGS__), stringf(__VA_ARGS__))  // vs2015 check trick
+char*   stringf_keep(const char *s); // promote a temporary string to heap. FREE() it when done.
+void    stringf_reset(); // recycle all temporary strings from calling thread. fwk does this at window_swap().
+int     stringf_volume(); // bytes handed out to calling thread since last reset
 
 #if 0
 // string: allocated api (heap)
@@ -93,10 +98,26 @@ int     is_stringf(const char *s);
 #define strtok_r strtok_s
 #endif
 
+// tokenizes a temporary copy of str (any length). prefer each_strview() when a copy is not needed.
 #define each_substring(str, delims, keyname) \
-    ( char buf[1024], *_lit = (char*)(str), *_bak = (snprintf(buf, 1024, "%s", _lit), buf); _bak; _bak = 0 ) \
+    ( char *_bak = stringf("%s", (str)); _bak; _bak = 0 ) \
     for( char *next_token = 0, *keyname = strtok_r(_bak, delims, &next_token); keyname; keyname = strtok_r(NULL, delims, &next_token) )
 
+// string: views (non-owning slices, not null-terminated). split/trim/compare without copying.
+typedef struct strview { const char *ptr; int len; } strview;
+strview strview_from(const char *s); // whole C string. NULL is an empty view
+strview strview_make(const char *ptr, int len);
+strview strview_trim(strview v); // strip leading and trailing whitespace
+int     strview_next(strview *src, const char *delims, strview *token); // pops next non-empty token from src. 0 when exhausted
+int     strview_cmp(strview a, strview b); // strcmp() ordering
+int     strview_eq(strview v, const char *s); // 1 if v matches null-terminated s
+int     strview_atoi(strview v);
+char*   strview_dup(strview v); // temporary null-terminated copy (stringf)
+#define strview_hash(v) hash_bin((v).ptr, (v).len)
+
+#define each_strview(str, delims, keyname) \
+    ( strview keyname##_src = strview_from(str), keyname = {0}; strview_next(&keyname##_src, delims, &keyname); )
+
 #endif // STRING_H
 
 // -----------------------------------------------------------------------------
@@ -104,23 +125,66 @@ int     is_stringf(const char *s);
 #ifdef STRING_C
 #pragma once
 
+#ifndef STRINGF_BLOCKSIZE
+#define STRINGF_BLOCKSIZE (64 * 1024) // arena grows in chained blocks of this size (or larger, for big strings)
+#endif
+#ifndef STRINGF_MAXVOLUME
+#define STRINGF_MAXVOLUME (16 * 1024 * 1024) // threads that never reset wrap around after this many bytes, like a ring
+#endif
+
+typedef struct stringf_block {
+    struct stringf_block *next;
+    int used, cap;
+} stringf_block;
+
+static THREAD stringf_block *stringf_head, *stringf_cur;
+static THREAD int stringf_bytes;
+
+static char *stringf_alloc(int reqlen) {
+    if( (stringf_bytes + reqlen) > STRINGF_MAXVOLUME ) stringf_reset();
+
+    stringf_block *b = stringf_cur;
+    if( !b || (b->used + reqlen) > b->cap ) {
+        stringf_block *next = b ? b->next : 0;
+        if( !next || next->cap < reqlen ) {
+            // chain a new block after current one. spare blocks beyond it are kept
+            int cap = reqlen > STRINGF_BLOCKSIZE ? reqlen : STRINGF_BLOCKSIZE;
+            stringf_block *nb = (stringf_block*)REALLOC(0, sizeof(stringf_block) + cap);
+            nb->cap = cap;
+            nb->next = next;
+            if( b ) b->next = nb; else stringf_head = nb;
+            next = nb;
+        }
+        next->used = 0;
+        stringf_cur = b = next;
+    }
+
+    char *ptr = (char*)(b + 1) + b->used;
+    b->used += reqlen;
+    stringf_bytes += reqlen;
+    return ptr;
+}
+
+void stringf_reset() {
+    if( stringf_head ) stringf_head->used = 0;
+    stringf_cur = stringf_head;
+    stringf_bytes = 0;
+}
+int stringf_volume() {
+    return stringf_bytes;
+}
+char* stringf_keep(const char *s) {
+    int len = strlen(s) + 1;
+    return (char*)memcpy(REALLOC(0, len), s, len);
+}
+
 char* stringfv(const char *fmt, va_list vl) {
     va_list copy;
     va_copy(copy, vl);
     int sz = vsnprintf( 0, 0, fmt, copy ) + 1;
     va_end(copy);
 
-    int reqlen = sz;
-    char* ptr = 0;
-    enum { STACK_ALLOC = 16384 };
-    if( reqlen < STACK_ALLOC ) { // fit stack?
-        static THREAD char buf[STACK_ALLOC];
-        static THREAD int cur = 0, len = STACK_ALLOC;
-        //printf("string stack %d/%d\n", cur, STACK_ALLOC);
-        ptr = buf + (cur *= (cur+reqlen) < len, (cur += reqlen) - reqlen);
-    } else {
-        assert(!"no stack enough, increase STACK_ALLOC variable above");
-    }
+    char* ptr = stringf_alloc(sz);
 
     vsnprintf( ptr, sz, fmt, vl );
     return (char *)ptr;
@@ -133,6 +197,45 @@ char* (stringf)(const char *fmt, ...) {
     return s;
 }
 
+strview strview_make(const char *ptr, int len) {
+    strview v = { ptr, len };
+    return v;
+}
+strview strview_from(const char *s) {
+    return strview_make(s, s ? (int)strlen(s) : 0);
+}
+strview strview_trim(strview v) {
+    while( v.len > 0 && (unsigned char)v.ptr[0] <= ' ' ) ++v.ptr, --v.len;
+    while( v.len > 0 && (unsigned char)v.ptr[v.len-1] <= ' ' ) --v.len;
+    return v;
+}
+int strview_next(strview *src, const char *delims, strview *token) {
+    const char *p = src->ptr, *e = p + src->len;
+    while( p < e && strchr(delims, *p) && *p ) ++p;
+    const char *b = p;
+    while( p < e && !(strchr(delims, *p) && *p) ) ++p;
+    *token = strview_make(b, (int)(p - b));
+    src->len -= (int)(p - src->ptr), src->ptr = p;
+    return token->len > 0;
+}
+int strview_cmp(strview a, strview b) {
+    int c = memcmp(a.ptr, b.ptr, a.len < b.len ? a.len : b.len);
+    return c ? c : (a.len > b.len) - (a.len < b.len);
+}
+int strview_eq(strview v, const char *s) {
+    return !strncmp(v.ptr, s, v.len) && !s[v.len];
+}
+int strview_atoi(strview v) {
+    int sign = 1, n = 0;
+    v = strview_trim(v);
+    if( v.len && (v.ptr[0] == '-' || v.ptr[0] == '+') ) sign = v.ptr[0] == '-' ? -1 : 1, ++v.ptr, --v.len;
+    for( ; v.len && v.ptr[0] >= '0' && v.ptr[0] <= '9'; ++v.ptr, --v.len ) n = n * 10 + (v.ptr[0] - '0');
+    return sign * n;
+}
+char* strview_dup(strview v) {
+    return stringf("%.*s", v.len, v.ptr ? v.ptr : "");
+}
+
 #if 0
 char* (stringf_cat)(char *src, const char *buf) {
     int srclen = (src ? strlen(src) : 0), buflen = strlen(buf);
@@ -199,6 +302,7 @@ uint32_t hash_32(uint32_t x);
 uint64_t hash_64(uint64_t x);
 uint64_t hash_flt(double x);
 uint64_t hash_str(char* str); // non-const arg for C++
+uint64_t hash_bin(const void *ptr, unsigned len);
 uint64_t hash_ptr(const void *ptr);
 
 #endif // HASH_H
@@ -237,11 +341,30 @@ uint64_t hash_flt(double x) {
 // }
 
 uint64_t hash_str(char* str) { // non-const arg for C++
-    // faster than fnv1a, a few more collisions though.
-    uint64_t hash = 0; // fnv1a: 14695981039346656037ULL;
-    while( *str ) {
-        hash = ( (unsigned char)*str++ ^ hash ) * 131; // fnv1a: 0x100000001b3ULL;
+    // same rounds than hash_bin(), in a single pass: no strlen() and no tail memcpy() on short keys. values differ from hash_bin()
+    uint64_t hash = 0x9E3779B97F4A7C15ULL, word = 0;
+    for( unsigned n = 0; *str; ++str ) {
+        word = (word << 8) | (unsigned char)*str;
+        if( ++n == 8 ) hash = (hash ^ word) * 0xff51afd7ed558ccdULL, hash ^= hash >> 32, word = 0, n = 0;
     }
+    hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 29;
+    return hash;
+}
+uint64_t hash_bin(const void *ptr, unsigned len) {
+    // word-at-a-time: 8 bytes per round, each one mixed with a 64-bit multiply + xorshift.
+    // much faster than bytewise fnv1a on paths and identifiers. values differ across endianness, so do not serialize them.
+    const char *str = (const char *)ptr;
+    uint64_t hash = len * 0x9E3779B97F4A7C15ULL, word;
+    for( ; len >= 8; len -= 8, str += 8 ) {
+        memcpy(&word, str, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    word = 0;
+    memcpy(&word, str, len);
+    hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 29;
     return hash;
 }
 uint64_t hash_int(int key) {
@@ -257,6 +380,145 @@ uint64_t hash_ptr(const void *ptr) {
 
 #endif // HASH_C
 
+// string interning (atoms)
+// - rlyeh, public domain
+
+#ifndef INTERN_H
+#define INTERN_H
+
+// atoms are stable 32-bit handles to unique strings. 0 is reserved for the empty string.
+// interned strings are never released, so keep them for names, paths and identifiers.
+unsigned    intern(const char *str);      // interns str if needed. threadsafe
+unsigned    interni(const char *path);    // same, case-insensitive and with '\\' slashes normalized to '/'
+unsigned    interned(const char *str);    // like intern(), but returns 0 if str was not interned before
+const char* intern_str(unsigned atom);    // stable pointer, valid forever
+uint64_t    intern_hash(unsigned atom);   // precomputed hash_str() of interned string
+unsigned    intern_len(unsigned atom);
+
+#endif // INTERN_H
+
+#ifdef INTERN_C
+#pragma once
+
+enum { INTERN_PAGE = 4096, INTERN_MAXPAGES = 4096 }; // up to 16M atoms
+
+typedef struct intern_entry {
+    const char *str;
+    uint64_t hash;
+    unsigned len;
+} intern_entry;
+
+static intern_entry *intern_pages[INTERN_MAXPAGES]; // pages never move, so readers need no lock
+static unsigned intern_count = 1; // atom 0 is the empty string
+static unsigned *intern_index, intern_index_cap; // open-addressing, linear probing. 0 is an empty slot
+static char *intern_block; static unsigned intern_block_left; // string storage
+static volatile int intern_lock_;
+
+static void intern_lock() {
+#ifdef _MSC
+    while( _InterlockedExchange((volatile long*)&intern_lock_, 1) ) {}
+#else
+    while( __sync_lock_test_and_set(&intern_lock_, 1) ) {}
+#endif
+}
+static void intern_unlock() {
+#ifdef _MSC
+    _InterlockedExchange((volatile long*)&intern_lock_, 0);
+#else
+    __sync_lock_release(&intern_lock_);
+#endif
+}
+
+static intern_entry *intern_entry_(unsigned atom) {
+    return &intern_pages[atom / INTERN_PAGE][atom % INTERN_PAGE];
+}
+
+static unsigned intern_find_(const char *str, unsigned len, uint64_t hash) { // lock must be held
+    if( !intern_index_cap ) return 0;
+    for( unsigned mask = intern_index_cap - 1, i = (unsigned)hash & mask; intern_index[i]; i = (i + 1) & mask ) {
+        intern_entry *e = intern_entry_(intern_index[i]);
+        if( e->hash == hash && e->len == len && !memcmp(e->str, str, len) ) return intern_index[i];
+    }
+    return 0;
+}
+
+static unsigned intern_add_(const char *str, unsigned len, uint64_t hash) { // lock must be held
+    if( (intern_count + 1) * 2 >= intern_index_cap ) { // rehash at 50% load
+        unsigned cap = intern_index_cap ? intern_index_cap * 2 : 4096;
+        unsigned *index = (unsigned*)REALLOC(0, cap * sizeof(unsigned));
+        memset(index, 0, cap * sizeof(unsigned));
+        for( unsigned atom = 1; atom < intern_count; ++atom ) {
+            unsigned i = (unsigned)intern_entry_(atom)->hash & (cap - 1);
+            while( index[i] ) i = (i + 1) & (cap - 1);
+            index[i] = atom;
+        }
+        REALLOC(intern_index, 0);
+        intern_index = index, intern_index_cap = cap;
+    }
+    unsigned atom = intern_count;
+    if( atom / INTERN_PAGE >= INTERN_MAXPAGES ) return 0;
+    if( !intern_pages[atom / INTERN_PAGE] ) {
+        intern_pages[atom / INTERN_PAGE] = (intern_entry*)REALLOC(0, INTERN_PAGE * sizeof(intern_entry));
+    }
+    if( intern_block_left < len + 1 ) {
+        intern_block_left = len + 1 > 64 * 1024 ? len + 1 : 64 * 1024;
+        intern_block = (char*)REALLOC(0, intern_block_left);
+    }
+    char *copy = (char*)memcpy(intern_block, str, len); copy[len] = 0;
+    intern_block += len + 1, intern_block_left -= len + 1;
+
+    intern_entry *e = intern_entry_(atom);
+    e->str = copy, e->hash = hash, e->len = len;
+
+    unsigned mask = intern_index_cap - 1, i = (unsigned)hash & mask;
+    while( intern_index[i] ) i = (i + 1) & mask;
+    intern_index[i] = atom;
+
+    return ++intern_count, atom;
+}
+
+static unsigned intern_(const char *str, int insert) {
+    if( !str || !str[0] ) return 0;
+    unsigned len = (unsigned)strlen(str);
+    uint64_t hash = hash_str((char*)str);
+    intern_lock();
+    unsigned atom = intern_find_(str, len, hash);
+    if( !atom && insert ) atom = intern_add_(str, len, hash);
+    intern_unlock();
+    return atom;
+}
+
+unsigned intern(const char *str) {
+    return intern_(str, 1);
+}
+unsigned interned(const char *str) {
+    return intern_(str, 0);
+}
+unsigned interni(const char *path) {
+    if( !path ) return 0;
+    char buf[256], *copy = buf;
+    int len = strlen(path);
+    if( len >= (int)sizeof(buf) ) copy = (char*)REALLOC(0, len + 1);
+    for( int i = 0; i <= len; ++i ) {
+        char c = path[i];
+        copy[i] = c == '\\' ? '/' : c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+    unsigned atom = intern_(copy, 1);
+    if( copy != buf ) REALLOC(copy, 0);
+    return atom;
+}
+const char* intern_str(unsigned atom) {
+    return atom && atom < intern_count ? intern_entry_(atom)->str : "";
+}
+uint64_t intern_hash(unsigned atom) {
+    return atom && atom < intern_count ? intern_entry_(atom)->hash : 0;
+}
+unsigned intern_len(unsigned atom) {
+    return atom && atom < intern_count ? intern_entry_(atom)->len : 0;
+}
+
+#endif // INTERN_C
+
 // #include "ds_hash.c"
 // #include "ds_sort.c"
 
@@ -269,6 +531,9 @@ uint64_t hash_ptr(const void *ptr) {
 // vector based allocator (x1.75 enlarge factor)
 void*  vrealloc(void* p, size_t sz);
 size_t vlen(void* p);
+size_t vcap(void* p); // length + spare bytes
+void*  vreserve(void* p, size_t sz); // grow capacity up to sz bytes, length unchanged. p must be valid
+void*  vshrink(void* p); // release spare bytes
 
 #endif // ALLOC_H
 
@@ -310,6 +575,25 @@ void* vrealloc( void* p, size_t sz ) {
 size_t vlen( void* p ) {
     return p ? 0[ (size_t*)p - 2 ] : 0;
 }
+size_t vcap( void* p ) {
+    return p ? 0[ (size_t*)p - 2 ] + 1[ (size_t*)p - 2 ] : 0;
+}
+void* vreserve( void* p, size_t sz ) {
+    size_t *ret = (size_t*)p - 2;
+    if( sz > ret[0] + ret[1] ) {
+        ret = (size_t*)REALLOC( ret, sizeof(size_t) * 2 + sz );
+        ret[1] = sz - ret[0];
+    }
+    return &ret[2];
+}
+void* vshrink( void* p ) {
+    size_t *ret = (size_t*)p - 2;
+    if( p && ret[1] ) {
+        ret = (size_t*)REALLOC( ret, sizeof(size_t) * 2 + ret[0] );
+        ret[1] = 0;
+    }
+    return p ? &ret[2] : 0;
+}
 
 #endif // ALLOC_C
 
@@ -345,14 +629,19 @@ static THREAD unsigned array_c_;
 #define array_vlen_(t)  ( vlen(t) - 0 )
 #define array_realloc_(t,n)  ( (t) = array_cast(t) vrealloc((t), ((n)+0) * sizeof(0[t])) )
 #define array_free(t) array_clear(t)
-#else // new: with reserve support (buggy still?)
-#define array_reserve(t, n) ( array_realloc_((t),(n)), array_clear(t) )
-#define array_clear(t) ( array_realloc_((t),0) ) // -1
+#else // new: with reserve support. one extra element is always allocated, so cleared arrays keep their buffer
+#define array_reserve(t, n) ( array_realloc_((t),array_count(t)), (t) = array_cast(t) vreserve((t), ((n)+1) * sizeof(0[t])) )
+#define array_clear(t) ( array_realloc_((t),0) ) // -1. keeps capacity
 #define array_vlen_(t)  ( vlen(t) - sizeof(0[t]) ) // -1
 #define array_realloc_(t,n)  ( (t) = array_cast(t) vrealloc((t), ((n)+1) * sizeof(0[t])) ) // +1
 #define array_free(t) ( array_realloc_((t), -1), (t) = 0 ) // -1
 #endif
 
+#define array_capacity(t) (int)( (t) ? vcap(t) / sizeof(0[t]) - 1 : 0 )
+#define array_shrink_to_fit(t) ( (t) = array_cast(t) vshrink(t) )
+#define array_push_n(t, src, n) ( array_c_ = array_count(t), array_realloc_((t),array_c_+(n)), memcpy(array_c_+(t),(src),(n)*sizeof(0[t])), (t) ) // src must not alias t
+#define array_extend(t, src) array_push_n(t, src, array_count(src))
+
 #define array_reverse(t) \
     do if( array_count(t) ) { \
         for(int l = array_count(t), e = l-1, i = (array_push(t, 0[t]), 0); i <= e/2; ++i ) \
@@ -390,10 +679,9 @@ static THREAD unsigned array_c_;
     } \
 } while(0)
 
-#define array_copy(t, src) do { /*todo: review old vrealloc call!*/ \
-    array_free(t); \
-    (t) = vrealloc( (t), array_count(src) * sizeof(0[t])); \
-    memcpy( (t), src, array_count(src) * sizeof(0[t])); \
+#define array_copy(t, src) do { \
+    array_clear(t); \
+    array_extend(t, src); \
 } while(0)
 
 #define array_erase(t, i) do { \
@@ -401,7 +689,7 @@ static THREAD unsigned array_c_;
     array_pop(t); \
 } while(0)
 
-#define array_unique(t, cmpfunc) do { /*todo: review old vrealloc call!*/ \
+#define array_unique(t, cmpfunc) do { \
     int cnt = array_count(t), dupes = 0; \
     if( cnt > 1 ) { \
         const void *prev = &(t)[0]; \
@@ -417,13 +705,156 @@ static THREAD unsigned array_c_;
             } \
         } \
         if( dupes ) { \
-            (t) = vrealloc((t), (array_count(t) - dupes) * sizeof(0[t])); \
+            array_realloc_((t), array_count(t) - dupes); \
         } \
     } \
 } while(0)
 
 #endif // ARRAY_H
 
+// radix sort ------------------------------------------------------------------
+// - rlyeh, public domain
+
+#ifndef SORT_H
+#define SORT_H
+
+// lsd radix sort (8-bit digits), ascending and stable. keys are compared as unsigned integers.
+// payload is optional: an unsigned per key (usually an index) that gets permuted along the keys.
+void radix_sort32(uint32_t *keys, unsigned *payload, int count);
+void radix_sort64(uint64_t *keys, unsigned *payload, int count);
+
+// sort key builders
+uint32_t sortkey_float(float f); // order-preserving bits. use sortkey_float(-depth) for back-to-front
+uint64_t sortkey_pack(uint32_t hi, uint32_t lo); // ie, sortkey_pack(texture_id, sortkey_float(depth))
+
+#define array_sort_radix(t, payload) /* t must be an array of 32/64-bit unsigned keys */ \
+    ( sizeof(0[t]) == 8 ? radix_sort64((uint64_t*)(t), (payload), array_count(t)) : radix_sort32((uint32_t*)(t), (payload), array_count(t)) )
+
+#endif // SORT_H
+
+#ifdef SORT_C
+#pragma once
+
+#define RADIX_SORT(KEY_T, keys, payload, count) do { \
+    enum { DIGITS = sizeof(KEY_T) }; \
+    KEY_T *src = (keys), *dst = (KEY_T*)REALLOC(0, (count) * sizeof(KEY_T)); \
+    unsigned *psrc = (payload), *pdst = psrc ? (unsigned*)REALLOC(0, (count) * sizeof(unsigned)) : 0; \
+    unsigned hist[DIGITS][256] = {0}; \
+    for( int i = 0; i < (count); ++i ) \
+        for( int d = 0; d < DIGITS; ++d ) ++hist[d][(src[i] >> (d * 8)) & 255]; \
+    for( int d = 0; d < DIGITS; ++d ) { \
+        unsigned *h = hist[d], sum = 0; \
+        if( h[(src[0] >> (d * 8)) & 255] == (count) ) continue; /* all keys share this digit */ \
+        for( int j = 0; j < 256; ++j ) { unsigned c = h[j]; h[j] = sum; sum += c; } \
+        if( psrc ) { \
+            for( int i = 0; i < (count); ++i ) { \
+                unsigned at = h[(src[i] >> (d * 8)) & 255]++; \
+                dst[at] = src[i], pdst[at] = psrc[i]; \
+            } \
+            unsigned *pswap = psrc; psrc = pdst; pdst = pswap; \
+        } else { \
+            for( int i = 0; i < (count); ++i ) dst[ h[(src[i] >> (d * 8)) & 255]++ ] = src[i]; \
+        } \
+        KEY_T *swap = src; src = dst; dst = swap; \
+    } \
+    if( src != (keys) ) { \
+        memcpy((keys), src, (count) * sizeof(KEY_T)), dst = src; \
+        if( psrc ) memcpy((payload), psrc, (count) * sizeof(unsigned)), pdst = psrc; \
+    } \
+    REALLOC(dst, 0); \
+    if( pdst ) REALLOC(pdst, 0); \
+} while(0)
+
+void radix_sort32(uint32_t *keys, unsigned *payload, int count) {
+    if( count > 1 ) RADIX_SORT(uint32_t, keys, payload, count);
+}
+void radix_sort64(uint64_t *keys, unsigned *payload, int count) {
+    if( count > 1 ) RADIX_SORT(uint64_t, keys, payload, count);
+}
+
+uint32_t sortkey_float(float f) {
+    union { float f; uint32_t u; } c = { f };
+    return c.u ^ (-(int32_t)(c.u >> 31) | 0x80000000u); // negatives: flip all bits. positives: flip sign bit
+}
+uint64_t sortkey_pack(uint32_t hi, uint32_t lo) {
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#ifdef SORT_DEMO
+#include <stdio.h>
+#include <time.h>
+
+static int sort_cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+static int sort_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void sort_tests() {
+    float depths[] = { 3.5f, -1.f, 0.f, -0.f, 1e30f, -1e30f, 0.25f, -0.25f };
+    uint32_t keys[8]; unsigned idx[8];
+    for( int i = 0; i < 8; ++i ) keys[i] = sortkey_float(depths[i]), idx[i] = i;
+    radix_sort32(keys, idx, 8);
+    for( int i = 1; i < 8; ++i ) assert( depths[idx[i-1]] <= depths[idx[i]] );
+    for( int i = 1; i < 8; ++i ) assert( keys[i-1] <= keys[i] );
+
+    // stability: equal hi keys keep their insertion order
+    uint64_t packed[6] = { sortkey_pack(2,0), sortkey_pack(1,0), sortkey_pack(2,0), sortkey_pack(1,0), sortkey_pack(0,7), sortkey_pack(2,0) };
+    unsigned order[6] = { 0,1,2,3,4,5 }, expected[6] = { 4,1,3,0,2,5 };
+    radix_sort64(packed, order, 6);
+    for( int i = 0; i < 6; ++i ) assert( order[i] == expected[i] );
+
+    array(uint32_t) a = 0;
+    for( int i = 0; i < 1000; ++i ) array_push(a, (uint32_t)(i * 2654435761u));
+    array_sort_radix(a, NULL);
+    for( int i = 1; i < array_count(a); ++i ) assert( a[i-1] <= a[i] );
+    array_free(a);
+
+    assert( ~puts("Ok") );
+}
+
+void sort_benchmark() {
+    int sizes[] = { 1000, 10000, 100000, 1000000 };
+    for( int s = 0; s < sizeof(sizes)/sizeof(0[sizes]); ++s ) {
+        int n = sizes[s], reps = 10000000 / n;
+        uint64_t *src = (uint64_t*)REALLOC(0, n * sizeof(uint64_t)), *a = (uint64_t*)REALLOC(0, n * sizeof(uint64_t));
+        unsigned *idx = (unsigned*)REALLOC(0, n * sizeof(unsigned));
+        uint64_t seed = 1;
+        for( int i = 0; i < n; ++i ) src[i] = (seed = seed * 6364136223846793005ULL + 1442695040888963407ULL);
+
+        #define SORT_BENCH(NAME, ...) do { \
+            clock_t t0 = clock(); \
+            for( int r = 0; r < reps; ++r ) { __VA_ARGS__; } \
+            double t = (clock() - t0) / (double)CLOCKS_PER_SEC; \
+            printf("%8d elems: %-20s %8.3f ms/sort\n", n, NAME, t * 1000 / reps); \
+        } while(0)
+
+        SORT_BENCH("qsort u32", for(int i = 0; i < n; ++i) ((uint32_t*)a)[i] = (uint32_t)src[i]; qsort(a, n, 4, sort_cmp_u32));
+        SORT_BENCH("radix u32", for(int i = 0; i < n; ++i) ((uint32_t*)a)[i] = (uint32_t)src[i]; radix_sort32((uint32_t*)a, NULL, n));
+        SORT_BENCH("radix u32+index", for(int i = 0; i < n; ++i) ((uint32_t*)a)[i] = (uint32_t)src[i], idx[i] = i; radix_sort32((uint32_t*)a, idx, n));
+        SORT_BENCH("qsort u64", memcpy(a, src, n * 8); qsort(a, n, 8, sort_cmp_u64));
+        SORT_BENCH("radix u64", memcpy(a, src, n * 8); radix_sort64(a, NULL, n));
+        SORT_BENCH("radix u64+index", for(int i = 0; i < n; ++i) a[i] = src[i], idx[i] = i; radix_sort64(a, idx, n));
+
+        for( int i = 1; i < n; ++i ) assert( a[i-1] <= a[i] && src[idx[i]] == a[i] );
+        REALLOC(src, 0), REALLOC(a, 0), REALLOC(idx, 0);
+    }
+}
+
+int main() {
+    sort_tests();
+    puts("---");
+    sort_benchmark();
+    assert(~puts("Ok"));
+}
+
+#define main main__
+#endif // SORT_DEMO
+#endif // SORT_C
+
 // generic map<K,V> container.
 // ideas from: https://en.wikipedia.org/wiki/Hash_table
 // ideas from: https://probablydance.com/2017/02/26/i-wrote-the-fastest-hashtable/
@@ -436,15 +867,19 @@ static THREAD unsigned array_c_;
 #include <stdint.h>
 #include <stdbool.h>
 
+// robin hood hashing (backward shift deletion) over an index of slots that grows with load factor.
+// entries are packed into pages that never move, so value pointers remain valid until their key is erased,
+// and iteration walks entries densely rather than slots. inserting an existing key replaces its entry in place.
+
 // config
 #ifndef MAP_REALLOC
 #define MAP_REALLOC REALLOC
 #endif
-#ifndef MAP_HASHSIZE
-#define MAP_HASHSIZE (4096 << 4)
+#ifndef MAP_MINSLOTS
+#define MAP_MINSLOTS 16
 #endif
-#ifndef MAP_DONT_ERASE
-#define MAP_DONT_ERASE 1
+#ifndef MAP_PAGE
+#define MAP_PAGE 16 // entries per page. power of two
 #endif
 
 // public api
@@ -461,14 +896,15 @@ static THREAD unsigned array_c_;
 
 #define map_free(m) ( \
     map_free(&(m)->base), \
-    map_cast(m) MAP_REALLOC((m), sizeof(*(m))), (m) = 0 \
+    map_cast(m) MAP_REALLOC((m), 0), (m) = 0 \
     )
 
 #define map_insert(m, k, v) ( \
-    (m)->ptr = map_cast((m)->ptr) MAP_REALLOC(0, sizeof((m)->tmp)), \
-    (m)->ptr->val = (v), \
-    (m)->ptr->p.keyhash = (m)->typed_hash((m)->ptr->key = (k)), \
-    map_insert(&(m)->base, &(m)->ptr->p, &(m)->ptr->key, &(m)->ptr->val, (m)->ptr->p.keyhash, (m)->ptr), \
+    (m)->tmp.val = (v), \
+    (m)->tmp.p.keyhash = (m)->typed_hash((m)->tmp.key = (k)), \
+    (m)->ptr = map_cast((m)->ptr) map_insert(&(m)->base, &(m)->tmp.key, (m)->tmp.p.keyhash, sizeof((m)->tmp)), \
+    *(m)->ptr = (m)->tmp, \
+    (m)->ptr->p.key = &(m)->ptr->key, (m)->ptr->p.value = &(m)->ptr->val, (m)->ptr->p.super = (m)->ptr, \
     &(m)->ptr->val \
     )
 
@@ -493,15 +929,15 @@ static THREAD unsigned array_c_;
 
 #define map_foreach(m,key_t,k,val_t,v) for each_map(m,key_t,k,val_t,v)
 #define each_map(m,key_t,k,val_t,v) \
-    ( int i_ = (m)->base.count ? 0 : MAP_HASHSIZE; i_ < MAP_HASHSIZE; ++i_) \
-        for( pair *cur_ = (m)->base.array[i_], *on_ = cur_; cur_; on_ = cur_ = cur_->next ) \
+    ( unsigned i_ = 0, e_ = (m)->base.used; i_ < e_; ++i_) \
+        for( pair *cur_ = map_entry_(&(m)->base, i_), *on_ = cur_->super ? cur_ : 0; on_; on_ = 0 ) \
             for( key_t k = *(key_t *)cur_->key; on_; ) \
                 for( val_t v = *(val_t *)cur_->value; on_; on_ = 0 )
 
 #define map_foreach_ptr(m,key_t,k,val_t,v) for each_map_ptr(m,key_t,k,val_t,v)
 #define each_map_ptr(m,key_t,k,val_t,v) \
-    ( int i_ = (m)->base.count ? 0 : MAP_HASHSIZE; i_ < MAP_HASHSIZE; ++i_) \
-        for( pair *cur_ = (m)->base.array[i_], *on_ = cur_; cur_; on_ = cur_ = cur_->next ) \
+    ( unsigned i_ = 0, e_ = (m)->base.used; i_ < e_; ++i_) \
+        for( pair *cur_ = map_entry_(&(m)->base, i_), *on_ = cur_->super ? cur_ : 0; on_; on_ = 0 ) \
             for( key_t *k = (key_t *)cur_->key; on_; ) \
                 for( val_t *v = (val_t *)cur_->value; on_; on_ = 0 )
 
@@ -521,29 +957,31 @@ static THREAD unsigned array_c_;
 #endif
 
 typedef struct pair {
-    struct pair *next;
-
-    uint64_t keyhash;
+    uint64_t keyhash; // next erased entry +1, if erased
     void *key;
     void *value;
-    void *super;
+    void *super; // entry itself, NULL if erased
 } pair;
 
 typedef struct map {
-    array(pair*) array;
+    uint64_t *slots; // per slot: (entry << 32) | (upper 24 hash bits << 8) | dib. dib: distance to initial bucket +1 (saturated at 255), 0 if empty slot
+    char **pages; // entries, MAP_PAGE per page
     int (*cmp)(void *, void *);
     uint64_t (*hash)(void *);
-    int count;
+    int count, cap, shift, size, npages;
+    unsigned used, erased; // entries handed out so far; first erased entry +1, if any
 } map;
 
+#define map_entry_(m, id) ( (pair*)((m)->pages[(id) / MAP_PAGE] + ((id) % MAP_PAGE) * (m)->size) )
+
 void  (map_init)(map *m);
 void  (map_free)(map *m);
 
-void  (map_insert)(map *m, pair *p, void *key, void *value, uint64_t keyhash, void *super);
+void* (map_insert)(map *m, void *key, uint64_t keyhash, int size); // entry to be filled by caller
 void  (map_erase)(map *m, void *key, uint64_t keyhash);
 void* (map_find)(map *m, void *key, uint64_t keyhash);
 int   (map_count)(map *m);
-void  (map_gc)(map *m); // only if using MAP_DONT_ERASE
+void  (map_gc)(map *m); // deprecated: erased entries are recycled immediately
 
 #endif // MAP_H
 
@@ -559,108 +997,168 @@ void  (map_gc)(map *m); // only if using MAP_DONT_ERASE
 #include <stdbool.h>
 #include <string.h>
 
-enum { MAP_GC_SLOT = MAP_HASHSIZE };
-typedef int map_is_pow2_assert[ !(MAP_HASHSIZE & (MAP_HASHSIZE - 1)) ];
-
-static int map_get_index(uint64_t hkey1) {
-    return hkey1 & (MAP_HASHSIZE-1);
+static uint64_t map_mix(uint64_t keyhash) { // fibonacci hashing. spreads weak hashes (ie, hash_ptr, hash_int) over the upper bits
+    return keyhash * 0x9E3779B97F4A7C15ULL;
+}
+static uint32_t map_home_(map *m, uint64_t mixed) { // initial bucket, from the upper bits of the whole 64-bit hash
+    return (uint32_t)(mixed >> m->shift);
+}
+static uint32_t map_slothome_(map *m, uint64_t slot) { // slots keep the upper 24 bits of the hash. bigger tables resolve it thru their entry
+    if( m->shift >= 40 ) return ((uint32_t)slot >> 8) >> (m->shift - 40);
+    return map_home_(m, map_mix(map_entry_(m, (uint32_t)(slot >> 32))->keyhash));
+}
+static uint32_t map_dib_(map *m, uint64_t slot, uint32_t i) { // saturated distances are recomputed from the initial bucket
+    uint32_t dib = slot & 0xFF;
+    if( dib == 0xFF ) dib = ((i - map_slothome_(m, slot)) & (m->cap - 1)) + 1;
+    return dib;
 }
 
 void (map_init)(map* m) {
     map c = {0};
     *m = c;
+}
 
-    array_resize(m->array, (MAP_HASHSIZE+1));
-    memset(m->array, 0, (MAP_HASHSIZE+1) * sizeof(m->array[0]) ); // array_resize() just did memset()
+static void map_place_(map *m, uint64_t slot, uint32_t i, uint32_t dib) { // robin hood. runs stay sorted by initial bucket, so placing shifts the rest of the run by one
+    uint32_t mask = m->cap - 1, j;
+    while( map_dib_(m, m->slots[i], i) >= dib ) i = (i + 1) & mask, ++dib; // skip poorer and equal entries
+    for( j = i; m->slots[j]; j = (j + 1) & mask ) {}
+    for( ; j != i; j = (j - 1) & mask ) {
+        uint64_t s = m->slots[(j - 1) & mask];
+        m->slots[j] = s + ((s & 0xFF) < 0xFF);
+    }
+    m->slots[i] = slot | (dib < 0xFF ? dib : 0xFF);
 }
 
-void (map_insert)(map* m, pair *p, void *key, void *value, uint64_t keyhash, void *super) {
-    p->keyhash = keyhash;
-    p->key = key;
-    p->value = value;
-    p->super = super;
+static void map_rehash_(map *m, int cap) { // entries do not move. only the index is rebuilt
+    uint64_t *old = m->slots;
+    uint32_t oldcap = m->cap, start = 0;
+    m->slots = (uint64_t*)MAP_REALLOC(0, cap * sizeof(uint64_t));
+    memset(m->slots, 0, cap * sizeof(uint64_t));
+    m->cap = cap;
+    for( m->shift = 64; cap > 1; cap >>= 1 ) --m->shift;
+
+    // old slots are walked from an empty one, so runs come sorted by initial bucket and placing them barely shifts
+    while( start < oldcap && old[start] ) ++start;
+    for( uint32_t k = 0; k < oldcap; ++k ) {
+        uint64_t s = old[(start + k) & (oldcap - 1)];
+        if( s ) map_place_(m, s & ~(uint64_t)0xFF, map_slothome_(m, s), 1);
+    }
+    if( old ) MAP_REALLOC(old, 0); // realloc(0,0) may allocate
+}
 
-    /* Insert onto the beginning of the list */
-    int index = map_get_index(p->keyhash);
-    p->next = m->array[index];
-    m->array[index] = p;
+static int map_lookup_(map *m, void *key, uint64_t keyhash, uint32_t *at, uint32_t *atdib) { // returns slot index or -1, and where the key would be placed
+    uint64_t mixed = map_mix(keyhash);
+    uint32_t mask = m->cap - 1, i = map_home_(m, mixed), dib = 1, bits = (uint32_t)(mixed >> 40) << 8;
+    for( ; ; i = (i + 1) & mask, ++dib ) {
+        uint64_t s = m->slots[i];
+        uint32_t t = (uint32_t)s & 0xFF;
+        if( t < dib && (t < 0xFF || map_dib_(m, s, i) < dib) ) return *at = i, *atdib = dib, -1; // empty, or would have been placed before
+        if( ((uint32_t)s & 0xFFFFFF00u) == bits ) {
+            pair *p = map_entry_(m, (uint32_t)(s >> 32));
+            char **c = (char **)p->key;
+            char **k = (char **)key;
+            if( p->keyhash == keyhash && !m->cmp(c[0], k[0]) ) return i;
+        }
+    }
+}
 
-    ++m->count;
+static void map_remove_(map *m, int i) { // backward shift deletion. no tombstones
+    uint32_t mask = m->cap - 1, dib;
+    for( uint32_t j = (i + 1) & mask; (dib = map_dib_(m, m->slots[j], j)) > 1; i = j, j = (j + 1) & mask ) {
+        --dib;
+        m->slots[i] = (m->slots[j] & ~(uint64_t)0xFF) | (dib < 0xFF ? dib : 0xFF);
+    }
+    m->slots[i] = 0;
+    --m->count;
 }
 
-void* (map_find)(map* m, void *key, uint64_t keyhash) {
-    int index = map_get_index(keyhash);
-    for( pair *cur = m->array[index]; cur; cur = cur->next ) {
-        if( cur->keyhash == keyhash ) {
-            char **c = (char **)cur->key;
+static uint32_t map_alloc_(map *m) { // recycles erased entries first
+    if( m->erased ) {
+        uint32_t id = m->erased - 1;
+        m->erased = (unsigned)map_entry_(m, id)->keyhash;
+        return id;
+    }
+    if( m->used / MAP_PAGE >= m->npages ) { // pages are allocated in blocks of 1,1,2,4,8.. pages, so few allocations
+        int n = m->npages ? m->npages : 1;
+        char *block = (char*)MAP_REALLOC(0, n * MAP_PAGE * m->size);
+        m->pages = (char**)MAP_REALLOC(m->pages, (m->npages + n) * sizeof(char*));
+        for( int i = 0; i < n; ++i ) m->pages[m->npages++] = block + i * MAP_PAGE * m->size;
+    }
+    return m->used++;
+}
+
+void* (map_insert)(map* m, void *key, uint64_t keyhash, int size) {
+    m->size = size;
+
+    // grow at 87.5% load. 4x while small, as slots are cheap and reindexing is not
+    if( (m->count + 1) * 8 > m->cap * 7 ) {
+        map_rehash_(m, !m->cap ? MAP_MINSLOTS : m->cap < 65536 ? m->cap * 4 : m->cap * 2);
+    }
+
+    // replace existing key, if any. else take a new entry
+    pair *e;
+    uint32_t at, atdib;
+    int found = map_lookup_(m, key, keyhash, &at, &atdib);
+    if( found >= 0 ) {
+        e = map_entry_(m, (uint32_t)(m->slots[found] >> 32));
+    } else {
+        uint32_t id = map_alloc_(m);
+        map_place_(m, ((uint64_t)id << 32) | (uint32_t)(map_mix(keyhash) >> 40) << 8, at, atdib);
+        e = map_entry_(m, id);
+        ++m->count;
+    }
+    return e;
+}
+
+void* (map_find)(map* m, void *key, uint64_t keyhash) { // map_lookup_(), unrolled here as this is the hottest path
+    if( !m->count ) return 0;
+    uint64_t mixed = map_mix(keyhash);
+    uint32_t mask = m->cap - 1, i = map_home_(m, mixed), dib = 1, bits = (uint32_t)(mixed >> 40) << 8;
+    for( ; ; i = (i + 1) & mask, ++dib ) {
+        uint64_t s = m->slots[i];
+        uint32_t t = (uint32_t)s & 0xFF;
+        if( t < dib && (t < 0xFF || map_dib_(m, s, i) < dib) ) return 0;
+        if( ((uint32_t)s & 0xFFFFFF00u) == bits ) {
+            pair *p = map_entry_(m, (uint32_t)(s >> 32));
+            char **c = (char **)p->key;
             char **k = (char **)key;
-            if( !m->cmp(c[0], k[0]) ) {
-                return cur->super;
-            }
+            if( p->keyhash == keyhash && !m->cmp(c[0], k[0]) ) return p;
         }
     }
-    return 0;
 }
 
 void (map_erase)(map* m, void *key, uint64_t keyhash) {
-    int index = map_get_index(keyhash);
-    for( pair *prev = 0, *cur = m->array[index]; cur; (prev = cur), (cur = cur->next) ) {
-        if( cur->keyhash == keyhash ) {
-            char **c = (char **)cur->key;
-            char **k = (char **)key;
-            if( !m->cmp(c[0], k[0]) ) {
-                if( prev ) prev->next = cur->next; else m->array[index] = cur->next ? cur->next : 0;
-#if MAP_DONT_ERASE
-                /* Insert onto the beginning of the GC list */
-                cur->next = m->array[MAP_GC_SLOT];
-                m->array[MAP_GC_SLOT] = cur;
-#else
-                MAP_REALLOC(cur,0);
-#endif
-                --m->count;
-                return;
-            }
-        }
+    uint32_t at, atdib;
+    int found = m->count ? map_lookup_(m, key, keyhash, &at, &atdib) : -1;
+    if( found >= 0 ) {
+        uint32_t id = (uint32_t)(m->slots[found] >> 32);
+        pair *e = map_entry_(m, id);
+        map_remove_(m, found);
+        e->super = 0;
+        e->keyhash = m->erased;
+        m->erased = id + 1;
     }
 }
 
 int (map_count)(map* m) {
     return m->count;
-    int counter = 0;
-    for( int i = 0; i < MAP_HASHSIZE; ++i) {
-        for( pair *cur = m->array[i]; cur; cur = cur->next ) {
-            ++counter;
-        }
-    }
-    return counter;
 }
 
 void (map_gc)(map* m) {
-#if MAP_DONT_ERASE
-    for( pair *next, *cur = m->array[MAP_GC_SLOT]; cur; cur = next ) {
-        next = cur->next;
-        MAP_REALLOC(cur,0);
-    }
-    m->array[MAP_GC_SLOT] = 0;
-#endif
 }
 
-void (map_clear)(map* m) {
-    for( int i = 0; i <= MAP_HASHSIZE; ++i) {
-        for( pair *next, *cur = m->array[i]; cur; cur = next ) {
-            next = cur->next;
-            MAP_REALLOC(cur,0);
-        }
-        m->array[i] = 0;
-    }
+void (map_clear)(map* m) { // pages are kept for reuse
+    if( m->slots ) memset(m->slots, 0, m->cap * sizeof(uint64_t));
     m->count = 0;
+    m->used = m->erased = 0;
 }
 
 void (map_free)(map* m) {
-    (map_clear)(m);
-
-    array_free(m->array);
-    m->array = 0;
+    for( int i = 0; i < m->npages; i = i ? i * 2 : 1 ) { // first page of each block
+        MAP_REALLOC(m->pages[i], 0);
+    }
+    if( m->pages ) MAP_REALLOC(m->pages, 0);
+    if( m->slots ) MAP_REALLOC(m->slots, 0);
 
     map c = {0};
     *m = c;
@@ -676,6 +1174,53 @@ void (map_free)(map* m) {
 //#include <map>
 #endif
 
+// previous map implementation, condensed, for benchmarking purposes:
+// 65536 chained buckets, bytewise x131 string hash, one heap node per entry, erased nodes kept in a gc list
+// (MAP_DONT_ERASE) until destroyed. hash and compare are called thru function pointers, as map(K,V) does.
+typedef struct oldmap_node { struct oldmap_node *next; uint64_t keyhash; char *key; int val; } oldmap_node;
+typedef struct oldmap { oldmap_node *array[65536+1]; int count; uint64_t (*hash)(char *); int (*cmp)(char *, char *); } oldmap;
+static uint64_t oldmap_hash(char *str) {
+    uint64_t hash = 0;
+    while( *str ) hash = ( (unsigned char)*str++ ^ hash ) * 131;
+    return hash;
+}
+static oldmap *oldmap_new() {
+    oldmap *o = (oldmap*)MAP_REALLOC(0, sizeof(oldmap));
+    memset(o, 0, sizeof(oldmap));
+    return o->hash = oldmap_hash, o->cmp = less_str, o;
+}
+static void oldmap_insert(oldmap *o, char *key, int val) {
+    oldmap_node *n = (oldmap_node*)MAP_REALLOC(0, sizeof(oldmap_node));
+    n->keyhash = o->hash(key), n->key = key, n->val = val;
+    n->next = o->array[n->keyhash & 65535], o->array[n->keyhash & 65535] = n;
+    ++o->count;
+}
+static int *oldmap_find(oldmap *o, char *key) {
+    uint64_t h = o->hash(key);
+    for( oldmap_node *cur = o->array[h & 65535]; cur; cur = cur->next )
+        if( cur->keyhash == h && !o->cmp(cur->key, key) ) return &cur->val;
+    return 0;
+}
+static void oldmap_erase(oldmap *o, char *key) {
+    uint64_t h = o->hash(key);
+    for( oldmap_node *prev = 0, *cur = o->array[h & 65535]; cur; prev = cur, cur = cur->next ) {
+        if( cur->keyhash == h && !o->cmp(cur->key, key) ) {
+            if( prev ) prev->next = cur->next; else o->array[h & 65535] = cur->next;
+            cur->next = o->array[65536], o->array[65536] = cur;
+            --o->count;
+            return;
+        }
+    }
+}
+static void oldmap_foreach(oldmap *o) {
+    volatile int sum = 0;
+    for( int i = 0; i < 65536; ++i ) for( oldmap_node *cur = o->array[i]; cur; cur = cur->next ) sum += cur->val;
+}
+static void oldmap_free(oldmap *o) {
+    for( int i = 0; i <= 65536; ++i ) for( oldmap_node *next, *cur = o->array[i]; cur; cur = next ) next = cur->next, MAP_REALLOC(cur, 0);
+    MAP_REALLOC(o, 0);
+}
+
 void map_benchmark() {
     #ifndef M
     #define M 100
@@ -691,6 +1236,10 @@ void map_benchmark() {
                 bufs[i] = (char*)MAP_REALLOC(0, 16); \
                 sprintf(bufs[i], "%d", i); \
             } \
+            for( unsigned i = N, seed = 1; --i > 0; ) { /* shuffle, so access order is not sequential */ \
+                seed = seed * 1103515245 + 12345; \
+                unsigned j = (seed >> 8) % (i + 1); char *swap = bufs[i]; bufs[i] = bufs[j]; bufs[j] = swap; \
+            } \
         } \
         clock_t t0 = clock(); \
         for( int i = 0; i < M; ++i ) { \
@@ -733,6 +1282,17 @@ void map_benchmark() {
         map_free(m)
     );
 
+    oldmap *o = 0;
+    BENCH(
+        o = oldmap_new(),
+        o->count,
+        oldmap_insert(o, buf, i),
+        oldmap_find(o, buf),
+        oldmap_foreach(o),
+        oldmap_erase(o, buf),
+        oldmap_free(o)
+    );
+
 #ifdef __cplusplus
     using std_unordered_map = std::unordered_map<const char *,int>;
     BENCH(
@@ -1038,8 +1038,8 @@ void thread_atomic_int_store( thread_atomic_int_t* atomic, int desired )
 
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
-        __sync_lock_test_and_set( &atomic->i, desired );
-        __sync_lock_release( &atomic->i );
+        __sync_synchronize(); // release: test_and_set is an acquire barrier only
+        __sync_lock_test_and_set( &atomic->i, desired ); // note: __sync_lock_release() would store 0 back
     
     #else 
         #error Unknown platform.
@@ -1175,8 +1175,8 @@ void thread_atomic_ptr_store( thread_atomic_ptr_t* atomic, void* desired )
     
     #elif defined( __linux__ ) || defined( __APPLE__ ) || defined( __ANDROID__ )
 
-        __sync_lock_test_and_set( &atomic->ptr, desired );
-        __sync_lock_release( &atomic->ptr );
+        __sync_synchronize(); // release: test_and_set is an acquire barrier only
+        __sync_lock_test_and_set( &atomic->ptr, desired ); // note: __sync_lock_release() would store 0 back
     
     #else 
         #error Unknown platform.
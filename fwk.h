@@ -27,10 +27,12 @@
 // directives (debug /O0 /D3 > debugopt /O1 /D2 > release (ndebug) /O2 /D1 > final /O3 /D0)
 
 #ifdef FINAL
-#define WITH_PROFILE       0
-#define WITH_COOKER        0
-#define WITH_FASTCALL_LUA  1
-#define WITH_LEAK_DETECTOR 0
+#define WITH_PROFILE        0
+#define WITH_COOKER         0
+#define WITH_HOTRELOAD      0
+#define WITH_FASTCALL_LUA   1
+#define WITH_LEAK_DETECTOR  0
+#define WITH_ALLOC_PROFILER 0
 #endif
 
 // defaults:
@@ -43,6 +45,10 @@
 #define WITH_COOKER 1
 #endif
 
+#ifndef WITH_HOTRELOAD
+#define WITH_HOTRELOAD 1 // recooks and reloads assets modified while running. requires WITH_COOKER
+#endif
+
 #ifndef WITH_FASTCALL_LUA
 #define WITH_FASTCALL_LUA 0
 #endif
@@ -51,6 +57,10 @@
 #define WITH_LEAK_DETECTOR 0
 #endif
 
+#ifndef WITH_ALLOC_PROFILER
+#define WITH_ALLOC_PROFILER 0
+#endif
+
 // -----------------------------------------------------------------------------
 // forward includes
 
@@ -362,25 +372,26 @@ const char *pathfile_from_handle(FILE *fp) {
 // profiler & stats (@fixme: threadsafe)
 
 #if WITH_PROFILE
-#   define profile_init() map_init(profiler, less_str, hash_str)
+#   define profile_init() map_init(profiler, less_int, hash_int)
 #   define profile(...) for( \
-        struct profile_t *found = map_find_or_add(profiler, #__VA_ARGS__ "@" FILELINE, (struct profile_t){NAN} ), *dummy = (\
+        struct profile_t *found = map_find_or_add(profiler, intern(#__VA_ARGS__ "@" FILELINE), (struct profile_t){NAN} ), *dummy = (\
         found->cost = -time_ms() * 1000, found); found->cost < 0; found->cost += time_ms() * 1000, found->avg = found->cost * 0.25 + found->avg * 0.75)
 #   define profile_incstat(name, accum) do { if(profiler) { \
-        struct profile_t *found = map_find(profiler, name); \
-        if(!found) found = map_insert(profiler, name, (struct profile_t){0}); \
+        unsigned key_ = intern(name); \
+        struct profile_t *found = map_find(profiler, key_); \
+        if(!found) found = map_insert(profiler, key_, (struct profile_t){0}); \
         found->stat += accum; \
         } } while(0)
 #   define profile_render() if(profiler) do { \
         for(float _i = ui_begin("Profiler",0), _r; _i ; ui_end(), _i = 0) { \
-            for each_map_ptr(profiler, const char *, key, struct profile_t, val ) \
-                if( !isnan(val->stat) ) ui_slider2(stringf("Stat: %s", *key), (_r = val->stat, &_r), stringf("%.2f ", val->stat)), val->stat = 0; \
+            for each_map_ptr(profiler, unsigned, key, struct profile_t, val ) \
+                if( !isnan(val->stat) ) ui_slider2(stringf("Stat: %s", intern_str(*key)), (_r = val->stat, &_r), stringf("%.2f ", val->stat)), val->stat = 0; \
             ui_separator(); \
-            for each_map_ptr(profiler, const char *, key, struct profile_t, val ) \
-                if( isnan(val->stat) ) ui_slider2(*key, (_r = val->avg/1000.0, &_r), stringf("%.2f ms ", val->avg/1000.0)); \
+            for each_map_ptr(profiler, unsigned, key, struct profile_t, val ) \
+                if( isnan(val->stat) ) ui_slider2(intern_str(*key), (_r = val->avg/1000.0, &_r), stringf("%.2f ms ", val->avg/1000.0)); \
         } } while(0)
 struct profile_t { double stat; int32_t cost, avg; };
-static map(char *, struct profile_t) profiler = 0;
+static map(unsigned, struct profile_t) profiler = 0; // keyed by interned name
 #else
 #   define profile_init() do {} while(0)
 #   define profile_incstat(name, accum) do {} while(0)
@@ -473,9 +484,12 @@ static int (cookme)(const char *cmd) {
 
 static
 int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, FILE *out, const char *info) {
-    // reserve i/o buffer (2 MiB)
+    // reserve i/o buffer (2 MiB). one per cooker worker
     enum { BUFSIZE = 2 * 1024 * 1024 };
-    static char *buffer = 0; if(!buffer) buffer = REALLOC(0, BUFSIZE);
+    static threadlocal char *buffer = 0; if(!buffer) buffer = REALLOC(0, BUFSIZE);
+
+    // intermediate files are named after the asset, so concurrent workers do not clash
+    const char *temp = stringf(".temp.%016llx", (unsigned long long)hash_str(filename));
 
     // exclude extension-less files
     if( !ext[0] ) goto bypass;
@@ -517,8 +531,8 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
 
             int rc;
             const char *infile, *outfile;
-            char temp_iqe[16] = ".temp.iqe";
-            char temp_iqm[16] = ".temp.iqm";
+            const char *temp_iqe = stringf("%s.iqe", temp);
+            const char *temp_iqm = stringf("%s.iqm", temp);
 
             rc = cookme("3rd\\3rd_tools\\ass2iqe %s -o %s \"%s\"", option_flip_uv, outfile = temp_iqe, infile = filename);
 #ifdef __linux__
@@ -547,7 +561,7 @@ int fwk_cook(char *filename, const char *ext, const char header[16], FILE *in, F
 
             int rc;
             const char *infile, *outfile;
-            char temp_wav[16] = ".temp.wav";
+            const char *temp_wav = stringf("%s.wav", temp);
 
             rc = cookme("3rd\\3rd_tools\\mid2wav \"%s\" %s %s", infile = filename, outfile = temp_wav, option_soundbank_file);
             tty_color(rc || !file_size(outfile) ? RED : color_from_textlog(os_exec_output()));
@@ -640,7 +654,7 @@ void fwk_init() {
 
     // create or update cook.zip file
 #if WITH_COOKER
-    cooker( "**", COOKER_CALLBACK, 0|COOKER_ASYNC );
+    cooker( "**", COOKER_CALLBACK, 0|COOKER_ASYNC|(WITH_HOTRELOAD ? COOKER_WATCH : 0) );
 #endif
 }
 
@@ -6,6 +6,7 @@
 // @todo: destroystream()    if( ss->type == WAV ) drwav_uninit(&ss->wav);
 // @todo: destroystream()    if( ss->type == MOD ) jar_mod_unload(&ss->mod);
 // @todo: destroystream()    if( ss->type == XM && ss->xm ) jar_xm_free_context(ss->xm);
+// @todo: destroystream()    if( ss->vfs ) vfs_fclose(ss->vfs); REALLOC(ss->mem, 0);
 
 #ifndef AUDIO_H
 #define AUDIO_H
@@ -50,6 +51,8 @@ typedef struct {
         drmp3           mp3_;
     };
     sts_mixer_stream_t  stream;             // mixer stream
+    vfs_file*           vfs;                // source, if streamed from mounted archives (wav, flac, mp3)
+    char*               mem;                // copy of archived file, for decoders that keep pointers into it (ogg, xm, mod)
     union {
     int32_t             data[4096*2];       // static sample buffer
     float               dataf[4096*2];
@@ -117,53 +120,84 @@ static void refill_stream(sts_mixer_sample_t* sample, void* userdata) {
     }
 }
 
+// vfs callbacks for dr_wav, dr_flac and dr_mp3. origin: 0 start, 1 current
+static size_t vfs_read_cb(void *userdata, void *buf, size_t len) {
+    return vfs_fread((vfs_file*)userdata, buf, (int)len);
+}
+static unsigned vfs_seek_cb(void *userdata, int offset, int origin) {
+    return 0 == vfs_fseek((vfs_file*)userdata, offset, origin ? SEEK_CUR : SEEK_SET);
+}
+
+static char *vfs_copy_(const char *pathfile, int *len) {
+    const char *view = vfs_map(pathfile, len);
+    return view ? memcpy(REALLOC(0, *len), view, *len) : NULL;
+}
+
 // load a (stereo) stream
 static bool load_stream(mystream_t* stream, const char *filename) {
     int error;
     int HZ = 44100;
     stream->type = UNK;
-    if( stream->type == UNK && (stream->ogg = stb_vorbis_open_filename(filename, &error, NULL)) ) {
+
+    // files not found on disk get played from mounted archives. decoders with callbacks stream them thru vfs_fopen(), and
+    // the others decode from a copy owned by the stream: vfs_map() views may get evicted while playing. both opened on demand
+    int archived = !file_size(filename);
+    vfs_file *vfs = 0; int vfs_len = 0;
+    #define vfs_rewind() (vfs ? vfs_fseek(vfs, 0, SEEK_SET), vfs : (vfs = vfs_fopen(filename)))
+    #define vfs_copy()   (stream->mem ? stream->mem : (stream->mem = vfs_copy_(filename, &vfs_len)))
+
+    if( stream->type == UNK && (stream->ogg = !archived ? stb_vorbis_open_filename(filename, &error, NULL) : vfs_copy() ? stb_vorbis_open_memory((const unsigned char *)stream->mem, vfs_len, &error, NULL) : NULL) ) {
         stb_vorbis_info info = stb_vorbis_get_info(stream->ogg);
         if( info.channels != 2 ) { puts("cannot stream ogg file. stereo required."); goto end; }
         stream->type = OGG;
         stream->stream.sample.frequency = info.sample_rate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && (drwav_init_file(&stream->wav, filename, NULL))) {
+    if( stream->type == UNK && (!archived ? drwav_init_file(&stream->wav, filename, NULL) : vfs_rewind() && drwav_init(&stream->wav, vfs_read_cb, (drwav_seek_proc)vfs_seek_cb, vfs, NULL))) {
         if( stream->wav.channels != 2 ) { puts("cannot stream wav file. stereo required."); goto end; }
         stream->type = WAV;
         stream->stream.sample.frequency = stream->wav.sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && (stream->flac = drflac_open_file(filename, NULL)) ) {
+    if( stream->type == UNK && (stream->flac = !archived ? drflac_open_file(filename, NULL) : vfs_rewind() ? drflac_open(vfs_read_cb, (drflac_seek_proc)vfs_seek_cb, vfs, NULL) : NULL) ) {
         if( stream->flac->channels != 2 ) { puts("cannot stream flac file. stereo required."); goto end; }
         stream->type = FLAC;
         stream->stream.sample.frequency = stream->flac->sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_FLOAT;
     }
-    if( stream->type == UNK && (jar_xm_create_context_from_file(&stream->xm, HZ, filename) == 0)) {
+    if( stream->type == UNK && ((!archived ? jar_xm_create_context_from_file(&stream->xm, HZ, filename) : vfs_copy() ? jar_xm_create_context_safe(&stream->xm, stream->mem, vfs_len, HZ) : -1) == 0)) {
         stream->type = XM;
         stream->stream.sample.frequency = HZ;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
-    if( stream->type == UNK && ((jar_mod_init(&stream->mod), jar_mod_load_file(&stream->mod, filename)) != 0) ) {
+    if( stream->type == UNK && ((jar_mod_init(&stream->mod), !archived ? jar_mod_load_file(&stream->mod, filename) : vfs_copy() ? jar_mod_load(&stream->mod, (void*)stream->mem, vfs_len) : 0) != 0) ) {
         stream->type = MOD;
         jar_mod_setcfg(&stream->mod, HZ, 16/*bits*/, 1/*stereo*/, 1/*stereo_separation*/, 1/*filter*/);
         stream->stream.sample.frequency = HZ;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_16;
     }
     drmp3_config mp3_cfg = { 2, HZ };
-    if( stream->type == UNK && (drmp3_init_file(&stream->mp3_, filename, NULL/*&mp3_cfg*/) != 0) ) {
+    if( stream->type == UNK && ((!archived ? drmp3_init_file(&stream->mp3_, filename, NULL/*&mp3_cfg*/) : vfs_rewind() ? drmp3_init(&stream->mp3_, vfs_read_cb, (drmp3_seek_proc)vfs_seek_cb, vfs, NULL) : 0) != 0) ) {
         stream->type = MP3;
         stream->stream.sample.frequency = stream->mp3_.sampleRate;
         stream->stream.sample.audio_format = STS_MIXER_SAMPLE_FORMAT_FLOAT;
     }
 
+    #undef vfs_copy
+    #undef vfs_rewind
+
     if( stream->type == UNK ) {
+        if( vfs ) vfs_fclose(vfs);
+        stream->mem = REALLOC(stream->mem, 0);
         return false;
     }
 
     end:;
+    // keep only the source that the chosen decoder reads from
+    int streamed = stream->type == WAV || stream->type == FLAC || stream->type == MP3;
+    if( vfs && !streamed ) vfs_fclose(vfs), vfs = 0;
+    if( stream->mem && streamed ) stream->mem = REALLOC(stream->mem, 0);
+    stream->vfs = vfs;
     stream->stream.userdata = stream;
     stream->stream.callback = refill_stream;
     stream->stream.sample.length = sizeof(stream->data) / sizeof(stream->data[0]);
@@ -175,9 +209,29 @@ static bool load_stream(mystream_t* stream, const char *filename) {
 
 // load a (mono) sample
 static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
+    // samples are fully decoded anyway, so decode them from memory: disk files get loaded, mounted archives get viewed
+    int len = 0;
+    char *owned = file_size(filename) ? file_load(filename, &len) : NULL;
+    const char *data = owned ? owned : vfs_map(filename, &len);
+    if( !data ) return false;
+
+    // pcm frames decoded by a previous run: { frequency, format, length, 0 } header, then mono frames.
+    // mixer voices play them straight from the mapping, which lives as long as the clip
+    uint64_t key = file_cache_key(data, len, "sample mono");
+    int cached_len; const unsigned *cached = (const unsigned *)file_cache_load(key, &cached_len);
+    if( cached && cached_len > 16 && (uint64_t)cached[2] * (cached[1] == STS_MIXER_SAMPLE_FORMAT_FLOAT ? sizeof(float) : sizeof(short)) == cached_len - 16 ) {
+        sample->frequency = cached[0];
+        sample->audio_format = cached[1];
+        sample->length = cached[2];
+        sample->data = (void *)(cached + 4);
+        owned = REALLOC(owned, 0);
+        return true;
+    }
+    if( cached ) file_cache_unload((const char *)cached, cached_len);
+
     int error;
     int channels = 0;
-    if( !channels ) for( drwav w = {0}, *wav = &w; wav && drwav_init_file(wav, filename, NULL); wav = 0 ) {
+    if( !channels ) for( drwav w = {0}, *wav = &w; wav && drwav_init_memory(wav, data, len, NULL); wav = 0 ) {
         channels = wav->channels;
         sample->frequency = wav->sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -186,7 +240,7 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
         drwav_read_pcm_frames_s16(wav, sample->length, (short*)sample->data);
         drwav_uninit(wav);
     }
-    if( !channels ) for( stb_vorbis *ogg = stb_vorbis_open_filename(filename, &error, NULL); ogg; ogg = 0 ) {
+    if( !channels ) for( stb_vorbis *ogg = stb_vorbis_open_memory((const unsigned char *)data, len, &error, NULL); ogg; ogg = 0 ) {
         stb_vorbis_info info = stb_vorbis_get_info(ogg);
         channels = info.channels;
         sample->frequency = info.sample_rate;
@@ -196,10 +250,10 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
 
         short *buffer;
         int sample_rate;
-        stb_vorbis_decode_filename(filename, &channels, &sample_rate, (short **)&buffer);
+        stb_vorbis_decode_memory((const unsigned char *)data, len, &channels, &sample_rate, (short **)&buffer);
         sample->data = buffer;
     }
-    if( !channels ) for( drflac* flac = drflac_open_file(filename, NULL); flac; flac = 0 ) {
+    if( !channels ) for( drflac* flac = drflac_open_memory(data, len, NULL); flac; flac = 0 ) {
         channels = flac->channels;
         sample->frequency = flac->sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -210,7 +264,7 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
     }
     drmp3_config mp3_cfg = { 2, 44100 };
     drmp3_uint64 mp3_fc;
-    if( !channels ) for( short *fbuf = 0; fbuf = drmp3_open_file_and_read_pcm_frames_s16(filename, &mp3_cfg, &mp3_fc, NULL); ) {
+    if( !channels ) for( short *fbuf = 0; fbuf = drmp3_open_memory_and_read_pcm_frames_s16(data, len, &mp3_cfg, &mp3_fc, NULL); ) {
         channels = mp3_cfg.channels;
         sample->frequency = mp3_cfg.sampleRate;
         sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
@@ -219,24 +273,21 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
         break;
     }
     if( !channels ) {
-        int inputSize = file_size( filename );
-        void *inputData = file_read( filename );
-        if( inputData ) {
-            short *output = 0;
-            int outputSize, hz, mp1channels;
-            bool ok = jo_read_mp1(inputData, inputSize, &output, &outputSize, &hz, &mp1channels);
-            if( ok ) {
-                channels = mp1channels;
-                sample->frequency = hz;
-                sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
-                sample->length = outputSize / sizeof(int16_t) / channels;
-                sample->data = REALLOC(0, sample->length * sizeof(int16_t) * channels );
-                memcpy( sample->data, output, outputSize );
-            }
-            REALLOC( inputData, 0 );
+        short *output = 0;
+        int outputSize, hz, mp1channels;
+        bool ok = jo_read_mp1(data, len, &output, &outputSize, &hz, &mp1channels);
+        if( ok ) {
+            channels = mp1channels;
+            sample->frequency = hz;
+            sample->audio_format = STS_MIXER_SAMPLE_FORMAT_16;
+            sample->length = outputSize / sizeof(int16_t) / channels;
+            sample->data = REALLOC(0, sample->length * sizeof(int16_t) * channels );
+            memcpy( sample->data, output, outputSize );
         }
     }
 
+    owned = REALLOC(owned, 0);
+
 #if 0
     if( !channels ) {
         //loadPreset(1, 0);
@@ -266,6 +317,15 @@ static bool load_sample(sts_mixer_sample_t* sample, const char *filename) {
         }
     }
 
+    int bytes = sample->length * (sample->audio_format == STS_MIXER_SAMPLE_FORMAT_FLOAT ? sizeof(float) : sizeof(short));
+    if( bytes >= FILE_CACHE_MIN ) {
+        unsigned *blob = REALLOC(0, 16 + bytes);
+        blob[0] = sample->frequency, blob[1] = sample->audio_format, blob[2] = sample->length, blob[3] = 0;
+        memcpy(blob + 4, sample->data, bytes);
+        file_cache_save(key, blob, 16 + bytes);
+        REALLOC(blob, 0);
+    }
+
     return true;
 }
 
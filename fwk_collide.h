@@ -14,7 +14,7 @@ typedef struct plane    { vec3 p, n;
 typedef struct capsule  { vec3 a, b; float r;                                         } capsule;
 typedef struct ray      { vec3 p, d;                                                  } ray;
 typedef struct triangle { vec3 p0,p1,p2;                                              } triangle;
-typedef struct poly     { vec3* verts; int cnt;                                       } poly;
+typedef struct poly     { vec3* verts; int cnt; int pooled; /*internal*/              } poly;
 typedef union  frustum  { struct { vec4 l, r, t, b, n, f; }; vec4 pl[6]; float v[24]; } frustum;
 
 #define line(...)       M_CAST(line, __VA_ARGS__)
@@ -115,7 +115,7 @@ frustum frustum_build(mat44 projview);
 int     frustum_test_sphere(frustum f, sphere s);
 int     frustum_test_aabb(frustum f, aabb a);
 
-poly    poly_alloc(int cnt);
+poly    poly_alloc(int cnt); // small polys (up to 6 verts) are pooled
 void    poly_free(poly *p);
 
 poly    pyramid(vec3 from, vec3 to, float size); // poly_free() required
@@ -129,15 +129,37 @@ poly    diamond(vec3 from, vec3 to, float size); // poly_free() required
 #pragma once
 
 /* poly */
+enum { POLY_POOLED_VERTS = 6 }; // fits pyramid() and diamond()
+static thread_atomic_ptr_t poly_pool;
+
+static pool_t *poly_pool_get() { // racing threads may both create it: the loser destroys its own
+    pool_t *pool = (pool_t*)thread_atomic_ptr_load(&poly_pool);
+    if( !pool ) {
+        pool_t *mine = pool_create(sizeof(vec3) * POLY_POOLED_VERTS, 256, 1);
+        pool = (pool_t*)thread_atomic_ptr_compare_and_swap(&poly_pool, 0, mine);
+        if( pool ) pool_destroy(mine); else pool = mine;
+    }
+    return pool;
+}
+
 poly poly_alloc(int cnt) {
     poly p = {0};
     p.cnt = cnt;
-    p.verts = REALLOC(p.verts, sizeof(p.verts[0]) * cnt); // array_resize(p.verts, cnt);
+    p.pooled = cnt <= POLY_POOLED_VERTS; // callers may change cnt later (ie, pyramid), so allocator is recorded
+    if( p.pooled ) {
+        p.verts = pool_alloc(poly_pool_get());
+    } else {
+        p.verts = REALLOC(p.verts, sizeof(p.verts[0]) * cnt); // array_resize(p.verts, cnt);
+    }
     return p;
 }
 
 void poly_free(poly *p) {
-    REALLOC(p->verts, 0); // array_free(p->verts);
+    if( p->pooled ) {
+        pool_free(poly_pool_get(), p->verts);
+    } else {
+        REALLOC(p->verts, 0); // array_free(p->verts);
+    }
     poly z = {0};
     *p = z;
 }
@@ -160,8 +182,7 @@ poly pyramid(vec3 from, vec3 to, float size) {
     vec3 nyext = scale3(up, -size);
 
     /* calculate base vertices */
-    poly p = {0};
-    p.verts = REALLOC(p.verts, sizeof(p.verts[0]) * (5+1)); p.cnt = 5; /*+1 for diamond case*/ // array_resize(p.verts, 5+1); p.cnt = 5;
+    poly p = poly_alloc(5+1); p.cnt = 5; /*+1 for diamond case*/
     p.verts[0] = add3(add3(from, xext), yext); /*a*/
     p.verts[1] = add3(add3(from, xext), nyext); /*b*/
     p.verts[2] = add3(add3(from, nxext), nyext); /*c*/
@@ -8,15 +8,18 @@
 // 3. - write its *cooked* contents into database, if local file was created or modified from disk.
 //
 // notes: meta-datas from every raw asset are stored into comment field, inside .cook.zip archive.
+// notes: entries are laid out in the load order recorded during last run (see vfs_trace()), so cold boots read mostly sequentially.
+// notes: files are split across COOKER_JOBS workers, each one cooking into its own .cook[N].zip shard. files are hashed by name, so each one
+// always lands on the same shard; archives cooked with a different COOKER_JOBS get cooked again from scratch.
 // @todo: fix leaks
 // @todo: symlink exact files
-// @todo: parallelize list of files in N cores. get N .cook files instead. mount them all.
 
 #ifndef COOKER_H
 #define COOKER_H
 
 enum {
     COOKER_ASYNC = 1,
+    COOKER_WATCH = 2, // recook files modified while running, then remount and reload them
 };
 
 // user defined callback for asset cooking:
@@ -25,7 +28,14 @@ enum {
 // must return compression level if archive needs to be cooked, else return <0
 typedef int (*cooker_callback_t)(char *filename, const char *ext, const char header[16], FILE *in, FILE *out, const char *info);
 
-int  cooker_progress(); // [0..100]
+#ifndef COOKER_JOBS
+#define COOKER_JOBS 4 // worker threads, and .cook[N].zip shards. up to 16 (fwk mounts .cook[0..15].zip)
+#endif
+static_assert(COOKER_JOBS >= 1 && COOKER_JOBS <= 16, "COOKER_JOBS: 1..16 workers (fwk mounts .cook[0..15].zip)");
+
+int  cooker_progress(); // [0..100], all workers
+int  cooker_jobs(); // COOKER_JOBS
+int  cooker_job_progress(int job); // [0..100], single worker
 bool cooker( const char *masks, cooker_callback_t cb, int flags );
 
 #endif
@@ -47,6 +57,9 @@ bool cooker( const char *masks, cooker_callback_t cb, int flags );
 #ifndef COOKER_TMPFILE
 #define COOKER_TMPFILE ".temp" // tmpnam(0) // ".temp"
 #endif
+#ifndef COOKER_TRACE
+#define COOKER_TRACE ".cook.trace" // vfs load order of last run. archives get laid out in this order
+#endif
 
 typedef struct fs {
     char *fname, status;
@@ -55,48 +68,60 @@ typedef struct fs {
 } fs;
 
 struct cooker_args {
-    const char **files;
+    const file_info *files;
     cooker_callback_t callback;
     char zipfile[16];
+    char tmpfile[16]; // one per worker, as callbacks run concurrently
     int from, to;
+    int shard, shards; // only files hashed to this shard get cooked here
+    int async; // owns its thread, so it can recycle temporary strings freely
+    int partial; // files are a subset (watched changes): neither scan for deletions nor report progress
+    volatile int progress; // [0..100]
+    const char *masks;
+    const char *trace; // COOKER_TRACE contents, as read before this run started recording its own
+    array(char*) added; // diff between files and zipfile
+    array(char*) changed;
+    array(char*) deleted;
+    array(char*) uncooked;
 };
 
+static
+uint64_t cooker__stamp_human(uint64_t stamp) { // 20210319113316, as file_stamp_human() does
+    time_t mtime = (time_t)stamp;
+    struct tm tm, *ti = &tm; // reentrant, as workers scan concurrently
+#ifdef _WIN32
+    localtime_s(ti, &mtime);
+#else
+    localtime_r(&mtime, ti);
+#endif
+    return ((ti->tm_year+1900) * 10000ULL + (ti->tm_mon+1) * 100 + ti->tm_mday) * 1000000ULL + ti->tm_hour * 10000 + ti->tm_min * 100 + ti->tm_sec;
+}
+
+static
+int cooker__shard(const char *fname, int shards) {
+    return shards > 1 ? (int)(hash_bin(fname, strlen(fname)) % shards) : 0;
+}
+
 static
 array(fs) cooker__fs_scan(struct cooker_args *args) {
     array(struct fs) fs = 0;
 
-    // iterate all previously scanned files
+    // iterate all previously scanned files. paths are relative already, and sizes and stamps were gathered by file_scan()
     for( int i = args->from; i < args->to; ++i ) {
-        const char *fname = args->files[i];
-        if( file_directory(fname) ) continue; // skip folders
+        const char *fname = args->files[i].name;
 
         // @todo: normalize path & rebase here (absolute to local)
         // [...]
         // fi.normalized = ; tolower->to_underscore([]();:+ )->remove_extra_underscores
 
-        // make buffer writable
-        char buffer[PATH_MAX];
-        snprintf(buffer, PATH_MAX, "%s", fname);
-
-        // get normalized current working directory (absolute)
-        char cwd[PATH_MAX] = {0};
-        getcwd(cwd, sizeof(cwd));
-        for(int i = 0; cwd[i]; ++i) if(cwd[i] == '\\') cwd[i] = '/';
-
-        // normalize path
-        for(int i = 0; buffer[i]; ++i) if(buffer[i] == '\\') buffer[i] = '/';
-
-        // rebase from absolute to relative
-        char *buf = buffer; int cwdlen = strlen(cwd);
-        if( !strncmp(buf, cwd, cwdlen) ) buf += cwdlen;
-        while(buf[0] == '/') ++buf;
-
-        if( file_name(buf)[0] == '.' ) continue; // skip system files
+        if( file_name(fname)[0] == '.' ) continue; // skip system files
+        if( cooker__shard(fname, args->shards) != args->shard ) continue; // cooked by another worker
 
         struct fs fi = {0};
-        fi.fname = STRDUP(buf);
-        fi.bytes = file_size(buf);
-        fi.stamp = file_stamp_human(buf); // human-readable base10 timestamp
+        fi.status = args->files[i].stamp ? 0 : 'D'; // partial scans list deleted files too
+        fi.fname = STRDUP(fname);
+        fi.bytes = args->files[i].size;
+        fi.stamp = cooker__stamp_human(args->files[i].stamp); // human-readable base10 timestamp
 
         array_push(fs, fi);
     }
@@ -104,37 +129,24 @@ array(fs) cooker__fs_scan(struct cooker_args *args) {
 }
 
 static
-fs *cooker__fs_locate(array(struct fs) fs, const char *file) {
-    for(int i = 0; i < array_count(fs); ++i) {
-        if( !strcmp(fs[i].fname,file)) {
-            return &fs[i];
-        }
-    }
-    return 0;
-}
-
-static array(char*) added;
-static array(char*) changed;
-static array(char*) deleted;
-static array(char*) uncooked;
-
-static
-int cooker__fs_diff( zip* old, array(fs) now ) {
-    array_free(added);
-    array_free(changed);
-    array_free(deleted);
-    array_free(uncooked);
+int cooker__fs_diff( struct cooker_args *args, zip* old, array(fs) now ) {
+    #define added    (args->added)
+    #define changed  (args->changed)
+    #define deleted  (args->deleted)
+    #define uncooked (args->uncooked)
+    int partial = args->partial;
 
     // if not zipfile is present, all files are new and must be added
     if( !old ) {
         for( int i = 0; i < array_count(now); ++i ) {
-            array_push(uncooked, STRDUP(now[i].fname));
+            if( now[i].status != 'D' ) array_push(uncooked, STRDUP(now[i].fname));
         }
         return 1;
     }
 
     // compare for new & changed files
     for( int i = 0; i < array_count(now); ++i ) {
+        if( now[i].status == 'D' ) continue;
         int found = zip_find(old, now[i].fname);
         if( found < 0 ) {
             array_push(added, STRDUP(now[i].fname));
@@ -149,25 +161,103 @@ int cooker__fs_diff( zip* old, array(fs) now ) {
             }
         }
     }
-    // compare for deleted files
+    // compare for deleted files. partial scans know them already
+    if( partial ) {
+        for( int i = 0; i < array_count(now); ++i ) {
+            if( now[i].status == 'D' && zip_find(old, now[i].fname) >= 0 ) array_push(deleted, STRDUP(now[i].fname));
+        }
+        return 1;
+    }
+    map(char*, int) present = 0;
+    map_init(present, less_str, hash_str);
+    for( int i = 0; i < array_count(now); ++i ) {
+        map_insert(present, now[i].fname, i);
+    }
     for( int i = 0; i < zip_count(old); ++i ) {
         char *oldname = zip_name(old, i);
         int idx = zip_find(old, oldname); // find latest versioned file in zip
+        if( idx != i ) continue; // older copy
         unsigned oldsize = zip_size(old, idx);
         if (!oldsize) continue;
-        fs *found = cooker__fs_locate(now, oldname);
-        if( !found ) {
+        if( !map_find(present, oldname) ) {
             array_push(deleted, STRDUP(oldname));
         }
     }
+    map_free(present);
     return 1;
+
+    #undef added
+    #undef changed
+    #undef deleted
+    #undef uncooked
+}
+
+static
+int cooker__layout( const char *zipfile, const char *trace ) { // rewrites zipfile with traced entries first, then the rest. 0 if layout was fine already
+    zip *in = zip_open(zipfile, "r");
+    if( !in ) return 0;
+
+    // latest copy of each entry only. older copies get dropped
+    unsigned count = zip_count(in);
+    array(int) order = 0;
+    char *placed = REALLOC(0, count + 1); memset(placed, 0, count + 1);
+    for each_substring(trace, "\r\n", name) {
+        int idx = zip_find(in, name);
+        if( idx >= 0 && !placed[idx] ) placed[idx] = 1, array_push(order, idx);
+    }
+    int traced = array_count(order);
+    for( unsigned i = 0; i < count; ++i ) {
+        if( !placed[i] && zip_find(in, zip_name(in, i)) == i ) array_push(order, i);
+    }
+
+    // order within the traced block is not compared: async loads trace it in a different order every run, and rewriting whole
+    // archives for that is not worth it. only stale copies, or traced entries outside of the leading block, trigger a new layout
+    int sorted = array_count(order) == count;
+    for( int i = 0; sorted && i < traced; ++i ) sorted = placed[i];
+
+    int ok = sorted;
+    if( !sorted ) {
+        const char *tmpfile = stringf("%s.tmp", zipfile);
+        zip *out = zip_open(tmpfile, "w");
+        ok = !!out;
+        for( int i = 0; ok && i < array_count(order); ++i ) ok = zip_append_raw(out, in, order[i]);
+        if( out ) zip_close(out);
+        zip_close(in), in = 0;
+        if( ok ) unlink(zipfile), ok = !rename(tmpfile, zipfile);
+        if( !ok ) unlink(tmpfile), PRINTF("cannot lay out %s in trace order\n", zipfile);
+    }
+    if( in ) zip_close(in);
+
+    REALLOC(placed, 0);
+    array_free(order);
+    return ok && !sorted;
 }
 
-static volatile int cooker__progress = 0;
+static volatile int cooker__progress = 0; // all workers. 100 once the last one finishes
+static struct cooker_args cooker__args[COOKER_JOBS];
+static thread_atomic_int_t cooker__running; // workers not finished yet
 
 int cooker_progress() {
     return cooker__progress;
 }
+int cooker_jobs() {
+    return COOKER_JOBS;
+}
+int cooker_job_progress(int job) {
+    return job >= 0 && job < COOKER_JOBS ? cooker__args[job].progress : 0;
+}
+
+static
+void cooker__report( struct cooker_args *args, int progress ) {
+    if( args->partial ) return;
+    args->progress = progress;
+
+    // mean of all workers, so the progress bar moves as a whole. only the last worker to finish reports 100
+    int sum = 0;
+    for( int i = 0; i < COOKER_JOBS; ++i ) sum += cooker__args[i].progress;
+    sum /= COOKER_JOBS;
+    cooker__progress = sum < 100 ? sum : 99;
+}
 
 static
 int cooker_sync( void *userptr ) {
@@ -179,9 +269,19 @@ int cooker_sync( void *userptr ) {
 
     if( file_size(args->zipfile) == 0 ) unlink(args->zipfile);
 
-    // populate added/deleted/changed arrays by examining current disk vs last cache
     zip *z = zip_open(args->zipfile, "r+b");
-    cooker__fs_diff(z, now);
+
+    // archives cooked with another COOKER_JOBS hold files of other shards, whose stale copies could shadow fresh ones once mounted. start over then
+    for( unsigned i = 0, end = z && !args->partial ? zip_count(z) : 0; i < end; ++i ) {
+        if( cooker__shard(zip_name(z, i), args->shards) == args->shard ) continue;
+        PRINTF("%s was cooked with another COOKER_JOBS setting. recooking\n", args->zipfile);
+        zip_close(z), z = 0;
+        unlink(args->zipfile);
+        break;
+    }
+
+    // populate added/deleted/changed arrays by examining current disk vs last cache
+    cooker__fs_diff(args, z, now);
     if( z ) zip_close(z);
 
     fflush(0);
@@ -194,20 +294,20 @@ int cooker_sync( void *userptr ) {
     }
 
     // deleted files
-    for( int i = 0, end = array_count(deleted); i < end; ++i ) {
-        printf("Deleting %03d%% %s\n", (i+1) == end ? 100 : (i * 100) / end, deleted[i]);
-        FILE* out = fopen(COOKER_TMPFILE, "wb"); fclose(out);
-        FILE* in = fopen(COOKER_TMPFILE, "rb");
+    for( int i = 0, end = array_count(args->deleted); i < end; ++i ) {
+        printf("Deleting %03d%% %s\n", (i+1) == end ? 100 : (i * 100) / end, args->deleted[i]);
+        FILE* out = fopen(args->tmpfile, "wb"); fclose(out);
+        FILE* in = fopen(args->tmpfile, "rb");
         char *comment = "0";
-        zip_append_file(z, deleted[i], comment, in, 0);
+        zip_append_file(z, args->deleted[i], comment, in, 0);
         fclose(in);
     }
     // added or changed files
-    // #pragma omp parallel for
-    for( int i = 0, end = array_count(uncooked); i < end; ++i ) {
-        cooker__progress = (i+1) == end ? 100 : (i * 100) / end; // (i+i>0) * 100.f / end;
+    for( int i = 0, end = array_count(args->uncooked); i < end; ++i ) {
+        cooker__report(args, (i+1) == end ? 100 : (i * 100) / end);
+        if( args->async ) stringf_reset();
 
-        char *fname = uncooked[i];
+        char *fname = args->uncooked[i];
 
         FILE *in = fopen(fname, "rb");
         if( !in ) PANIC("cannot open file for reading: %s", fname);
@@ -215,15 +315,15 @@ int cooker_sync( void *userptr ) {
         size_t inlen = ftell(in);
         fseek(in, 0L, SEEK_SET);
 
-        unlink(COOKER_TMPFILE);
-        FILE *out = fopen(COOKER_TMPFILE, "a+b");
-        if( !out ) PANIC("cannot open .temp file for writing");
+        unlink(args->tmpfile);
+        FILE *out = fopen(args->tmpfile, "a+b");
+        if( !out ) PANIC("cannot open %s file for writing", args->tmpfile);
         fseek(out, 0L, SEEK_SET);
 
         char *ext = strrchr(fname, '.'); ext = ext ? ext : ""; // .jpg
         char header[16]; fread(header, 1, 16, in); fseek(in, 0L, SEEK_SET);
 
-        const char *info = stringf("Cooking %03d%% %s\n", cooker__progress, uncooked[i]);
+        const char *info = stringf("Cooking %03d%% %s\n", args->progress, fname);
         int compression = (errno = 0, args->callback(fname, ext, header, in, out, info));
         int failed = errno != 0;
         if( failed ) PRINTF("importing failed: %s", fname);
@@ -240,10 +340,25 @@ int cooker_sync( void *userptr ) {
     }
     zip_close(z);
 
-    unlink(COOKER_TMPFILE);
+    unlink(args->tmpfile);
+
+    // reorder entries by last run's load trace. watched recooks append, until next boot lays them out again
+    if( !args->partial && args->trace ) cooker__layout(args->zipfile, args->trace);
     fflush(0);
 
-    cooker__progress = 100;
+    array(char*) lists[] = { args->added, args->changed, args->deleted, args->uncooked };
+    for( int l = 0; l < countof(lists); ++l ) {
+        for( int i = 0; i < array_count(lists[l]); ++i ) FREE(lists[l][i]);
+        array_free(lists[l]);
+    }
+    args->added = args->changed = args->deleted = args->uncooked = 0;
+    for( int i = 0; i < array_count(now); ++i ) FREE(now[i].fname);
+    array_free(now);
+
+    if( !args->partial ) {
+        cooker__report(args, 100);
+        if( thread_atomic_int_dec(&cooker__running) == 1 ) cooker__progress = 100; // last one. other reports happened before their decrements
+    }
     return 1;
 }
 
@@ -256,28 +371,100 @@ int cooker_async( void *userptr ) {
     return ret;
 }
 
+static
+int cooker_job( void *userptr ) {
+    int ret = cooker_sync(userptr);
+    thread_exit( ret );
+    return ret;
+}
+
+static
+int cooker_watch( void *userptr ) {
+    struct cooker_args *args = userptr; // all workers
+    file_watch(args->masks); // early, so edits made while cooking are caught too
+
+    while( cooker__progress <= 100 ) sleep_ms(100); // wait until archives are cooked and mounted
+
+    for(;;) {
+        sleep_ms(100);
+        stringf_reset();
+
+        const char **changes = file_changes();
+        if( !changes[0] ) continue;
+
+        // stat changed files, and group them by shard. deleted ones get no stamp
+        array(file_info) touched[COOKER_JOBS] = {0};
+        array(const char*) paths[COOKER_JOBS] = {0};
+        for( int i = 0; changes[i]; ++i ) {
+            if( file_name(changes[i])[0] == '.' ) continue; // system files: archives and temporaries
+            file_info fi = { changes[i] };
+            struct stat st;
+            if( stat(changes[i], &st) == 0 ) fi.size = st.st_size, fi.stamp = st.st_mtime;
+            int shard = cooker__shard(changes[i], COOKER_JOBS);
+            array_push(touched[shard], fi);
+            array_push(paths[shard], changes[i]);
+        }
+
+        for( int j = 0; j < COOKER_JOBS; ++j ) {
+            if( !array_count(touched[j]) ) continue;
+
+            struct cooker_args partial = args[j];
+            partial.files = touched[j];
+            partial.from = 0;
+            partial.to = array_count(touched[j]);
+            partial.partial = 1;
+            cooker_sync(&partial);
+
+            array_push(paths[j], 0);
+            vfs_remount(partial.zipfile, paths[j]); // reloads happen at window_swap()
+
+            array_free(touched[j]);
+            array_free(paths[j]);
+        }
+    }
+    return 0;
+}
+
 bool cooker( const char *masks, cooker_callback_t callback, int flags ) {
-    static struct cooker_args args[1] = {0};
-    const char **files = file_list(masks);
-    int numfiles = 0; while(files[numfiles]) ++numfiles;
-    args[0].files = files;
-    args[0].callback = callback;
-    args[0].from = 0;
-    args[0].to = numfiles;
-    for( int i = 0; i < countof(args); ++i) snprintf(args[i].zipfile, 16, ".cook[%d].zip", i);
+    struct cooker_args *args = cooker__args;
+    int numfiles = 0;
+    const file_info *files = file_scan(masks, &numfiles);
+    const char *trace = file_read(COOKER_TRACE); // before vfs_trace() truncates it
+    vfs_trace(COOKER_TRACE);
+
+    // shards beyond COOKER_JOBS are leftovers of a previous setting, which fwk would mount anyway
+    for( int i = COOKER_JOBS; i < 16; ++i ) unlink(stringf(".cook[%d].zip", i));
+
+    // every worker scans all files, and cooks the ones hashed to its own shard
+    for( int i = 0; i < COOKER_JOBS; ++i ) {
+        args[i].files = files;
+        args[i].callback = callback;
+        args[i].from = 0;
+        args[i].to = numfiles;
+        args[i].shard = i;
+        args[i].shards = COOKER_JOBS;
+        args[i].async = 1;
+        args[i].masks = i ? args[0].masks : STRDUP(masks);
+        args[i].trace = trace;
+        snprintf(args[i].zipfile, 16, ".cook[%d].zip", i);
+        snprintf(args[i].tmpfile, 16, "%s[%d]", COOKER_TMPFILE, i);
+    }
+    thread_atomic_int_store(&cooker__running, COOKER_JOBS);
     //
+    if( flags & COOKER_WATCH ) {
+        thread_create( cooker_watch, args, "cooker_watch()", 0/*STACK_SIZE*/ );
+    }
+    thread_ptr_t threads[COOKER_JOBS];
+    for( int i = 0; i < COOKER_JOBS; ++i ) {
+        if( flags & COOKER_ASYNC ) threads[i] = thread_create( cooker_async, &args[i], "cooker_async()", 0/*STACK_SIZE*/ );
+        else threads[i] = thread_create( cooker_job, &args[i], "cooker_job()", 0/*STACK_SIZE*/ );
+    }
     if( flags & COOKER_ASYNC ) {
-        int numthreads = countof(args);
-        for( int i = 0; i < numthreads; ++i ) {
-            args[i] = args[0];
-            args[i].from = i == 0 ? 0 : args[i-1].to;
-            args[i].to = i == (numthreads-1) ? numfiles : (numfiles * (i+1.) / numthreads);
-            thread_ptr_t thd = thread_create( cooker_async, &args[i], "cooker_async()", 0/*STACK_SIZE*/ );
-        }
         return true;
-    } else {
-        return !!cooker_sync( &args[0] );
     }
+    int ok = 1;
+    for( int i = 0; i < COOKER_JOBS; ++i ) ok &= !!thread_join(threads[i]), thread_destroy(threads[i]);
+    return ok;
 }
 
 #endif
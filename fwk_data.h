@@ -63,12 +63,12 @@ bool data_pop() {
 
 json5* data_node(const char *keypath) {
     json5 *j = array_back(roots), *r = j;
-    for each_substring( keypath, "/[.]", key ) {
+    for each_strview( keypath, "/[.]", key ) {
         r = 0;
-        /**/ if( j->type == JSON5_ARRAY ) r = j = &j->array[atoi(key)];
+        /**/ if( j->type == JSON5_ARRAY ) r = j = &j->array[strview_atoi(key)];
         else if( j->type == JSON5_OBJECT )
         for( int i = 0; !r && i < j->count; ++i ) {
-            if( j->nodes[i].name && !strcmp(j->nodes[i].name, key) ) {
+            if( j->nodes[i].name && strview_eq(key, j->nodes[i].name) ) {
                 r = j = &j->nodes[i];
                 break;
             }
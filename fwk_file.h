@@ -3,19 +3,33 @@
 //
 // - note: vfs_mount() order matters (last mounts have higher priority).
 // - note: directory/with/trailing/slash/ as mount_point, or zip/tar/pak archive otherwise.
-//
-// @todo: file_mmap
 
 #ifndef FILE_H
 #define FILE_H
 
 // physical filesystem. files
 
-const char** file_list(const char *masks); // **.png;*.c
+typedef struct file_info {
+    const char *name; // relative path, '/' separated
+    uint64_t size, stamp; // bytes, seconds since unix epoch
+} file_info;
+
+#ifndef FILE_SCAN_THREADS
+#define FILE_SCAN_THREADS 4 // parallel stat() calls, when the directory walk does not provide sizes and stamps
+#endif
+#ifndef FILE_SCAN_MINPARALLEL
+#define FILE_SCAN_MINPARALLEL 1024 // smaller scans are stat'ed in calling thread
+#endif
+
+const char** file_list(const char *masks); // **.png;*.c ('**' recurses into subdirs). sorted per mask
+const file_info* file_scan(const char *masks, int *count); // same, plus sizes and stamps. valid until next file_list() or file_scan() call from same thread
 char *       file_read(const char *filename);
 char *       file_load(const char *filename, int *len);
+const char * file_mmap(const char *filename, int *len); // read-only mapping. not null-terminated. NULL if missing or empty
+void         file_munmap(const char *ptr, int len);
 uint64_t     file_size(const char *pathfile);
 bool         file_directory(const char *pathfile);
+const char * file_find(const char *pathfile); // pathfile itself, if it is a file on disk. NULL otherwise. mounted archives are not looked up
 
 char *       file_path(const char *pathfile); // c:/prj/dir/file.ext -> c:/prj/dir/
 char *       file_name(const char *pathfile); // c:/prj/dir/file.ext -> file.ext
@@ -29,25 +43,134 @@ uint64_t     file_stamp_human(const char *pathfile); // 20210319113316 (datetime
 
 bool         file_copy(const char *src, const char *dst);
 
+// batched reads: many files (or ranges of them) read at once. io_uring on linux; worker threads elsewhere, or if io_uring is not available
+
+#ifndef FILE_BATCH_URING
+#define FILE_BATCH_URING 1
+#endif
+#ifndef FILE_BATCH_DEPTH
+#define FILE_BATCH_DEPTH 256 // io_uring reads in flight
+#endif
+#ifndef FILE_BATCH_THREADS
+#define FILE_BATCH_THREADS 8 // blocking readers, when io_uring is not available
+#endif
+
+typedef struct file_range {
+    const char *pathfile;
+    int64_t offset; int len; // len < 0 reads until end of file
+    char *data; int size;    // result, null-terminated. NULL if missing or short. REALLOC'd, caller frees
+} file_range;
+
+int          file_read_batch(file_range *ranges, int count); // ranges read ok
+
+// watcher: files created, modified or deleted on disk (inotify on linux; polled stamps elsewhere)
+
+#ifndef FILE_WATCH_POLL_MS
+#define FILE_WATCH_POLL_MS 1000 // rescan period, when inotify is not available
+#endif
+
+void         file_watch(const char *masks); // **.png;*.c. replaces previous masks
+const char** file_changes(); // interned paths changed since last call. null-terminated. call from same thread than file_watch()
+
+// decoded cache: post-decode blobs (pixels, pcm frames, vertex buffers) persisted on disk, so warm launches skip decoders.
+// keyed by source contents plus decode params. entries are machine-local: neither keys nor blobs are endian-neutral.
+
+#ifndef FILE_CACHE_DIR
+#define FILE_CACHE_DIR ".decoded/" // created on first save. "" disables the cache
+#endif
+#ifndef FILE_CACHE_MIN
+#define FILE_CACHE_MIN (16 << 10) // smaller blobs are not saved: decoding them again is cheaper than a file per blob
+#endif
+
+uint64_t     file_cache_key(const void *src, int len, const char *params); // params: decoder name and any flag changing its output. "image 0x8000"
+const char * file_cache_load(uint64_t key, int *size); // read-only mapping, 16-byte aligned. NULL if missing. file_cache_unload() it when done
+void         file_cache_unload(const char *blob, int size);
+bool         file_cache_save(uint64_t key, const void *blob, int size); // atomic rename, so concurrent savers and readers are fine
+
 // virtual filesystem
 
 bool         vfs_mount(const char *mount_point);
+bool         vfs_remount(const char *mount_point, const char **changed); // reopens an updated archive in place, drops changed files from cache and schedules their reloads. old archive is closed by cache_frame() once unused
 
 char *       vfs_read(const char *pathfile);
-char *       vfs_load(const char *pathfile, int *size);
+char *       vfs_load(const char *pathfile, int *size); // cached. do not free. valid until next cache_frame() (or until cache runs 2x over budget); see vfs_acquire() for long-lived buffers
+char *       vfs_acquire(const char *pathfile, int *size); // same than vfs_load(), but never evicted until vfs_release(). use it from worker threads
+void         vfs_release(const char *pathfile);
 int          vfs_size(const char *pathfile);
+int          vfs_load_batch(const char **pathfiles, int count, char **data, int *sizes); // vfs_load() of many files, with disk and tar/pak reads batched. sizes may be NULL. files found
 
+const char * vfs_map(const char *pathfile, int *size); // zero-copy view of stored entries in mounted zips. read-only, not null-terminated, do not free. falls back to vfs_load(), valid until next cache_frame()
 const char * vfs_resolve(const char *fuzzyname); // guess best match. @todo: fuzzy path
 FILE*        vfs_handle(const char *pathfile); // preferred way, will clean descriptors at exit
-const char * vfs_handlename(const char *pathfile); // workaround
+void         vfs_trace(const char *logfile); // records first-touch order of loaded pathfiles into logfile, one per line (truncated). NULL stops
 
-// cache
+// streams: seekable reads with bounded memory, from disk or mounted archives.
+// stored zip entries are read from the mapping; tar/pak entries from the archive file.
+// compressed zip entries have no random access, so they get fully decompressed at vfs_fopen() time.
+
+typedef struct vfs_file vfs_file;
+
+vfs_file*    vfs_fopen(const char *pathfile); // NULL if not found
+int          vfs_fread(vfs_file *fp, void *buf, int len); // bytes read
+int          vfs_fseek(vfs_file *fp, int64_t offset, int whence); // SEEK_SET/SEEK_CUR/SEEK_END. 0 if ok, like fseek()
+int64_t      vfs_ftell(vfs_file *fp);
+int64_t      vfs_fsize(vfs_file *fp);
+void         vfs_fclose(vfs_file *fp);
+
+// cache: loaded files, hashed by key and evicted least-recently-used first when over budget. all calls are thread-safe.
+// pointers handed out by cache_lookup()/cache_insert() (and vfs_load()) are not evicted until next cache_frame(), which window_swap()
+// runs thru vfs_async_update(). tools, and loading loops that do not swap, should call it themselves: until then, those entries are only
+// evicted once cache runs twice over budget, which invalidates them. acquire pointers to keep them for longer.
+
+#ifndef CACHE_BUDGET
+#define CACHE_BUDGET (256 << 20) // bytes
+#endif
+#ifndef CACHE_SHARDS
+#define CACHE_SHARDS 16 // independently locked slices, each one with CACHE_BUDGET/CACHE_SHARDS bytes
+#endif
+
+void *       cache_insert(const char *key, void *value, int size); // takes ownership of value (REALLOC'd); returns cached pointer
+void *       cache_lookup(const char *key, int *size); // cached pointer or NULL. no copy
+void *       cache_acquire(const char *key, int *size); // same than cache_lookup(), but entry is never evicted until released
+void         cache_release(const char *key);
+void         cache_budget(int64_t bytes); // evicts as needed
+void         cache_frame(); // ends a frame: unpinned pointers handed out until now may get evicted. vfs_async_update() calls it
+int64_t      cache_bytes();
+void         cache_stats(int64_t *hits, int64_t *misses, int64_t *evictions); // counted since last call
+
+// async loads: worker threads read (and optionally decode) files, by priority then fifo order.
+// finalize() calls happen on the main thread within a per-frame budget (window_swap() runs vfs_async_update()),
+// so gpu uploads of many finished loads get spread across frames.
 
-void *       cache_insert(const char *key, void *value, int size);
-void *       cache_lookup(const char *key, int *size);
+#ifndef ASYNC_WORKERS
+#define ASYNC_WORKERS 2
+#endif
+#ifndef ASYNC_BUDGET_MS
+#define ASYNC_BUDGET_MS 2.0 // main thread time spent on finalize() calls per frame. at least one call is made
+#endif
+
+enum { ASYNC_HIGH, ASYNC_NORMAL, ASYNC_LOW };
+
+typedef struct vfs_request {
+    const char *pathfile; // interned
+    char *data; int size; // file contents, null-terminated. NULL if not found. freed after finalize()
+    void *decoded;        // decode() result, if any
+    void *userdata;
+    int id, priority;
+    int cancelled;        // finalize() is still called, so it can release decoded/userdata
+} vfs_request;
 
-// @todo
-#define file_find vfs_handlename
+int          vfs_load_async(const char *pathfile, int priority, void* (*decode)(vfs_request *r), void (*finalize)(vfs_request *r), void *userdata); // request id. decode() runs on a worker, and it may be NULL
+int          vfs_cancel(int id); // 1 if request was still pending. it skips loading if not started yet
+int          vfs_pending(); // requests not finalized yet
+void         vfs_async_update(double budget_ms); // main thread only
+
+// hot-reload: callbacks run on the main thread (window_swap() runs vfs_reload_update()) after a remount changed pathfile.
+// registering the same pathfile+callback+userdata twice is a no-op.
+
+void         vfs_reload(const char *pathfile, void (*callback)(const char *pathfile, void *userdata), void *userdata);
+void         vfs_reload_off(const char *pathfile, void (*callback)(const char *pathfile, void *userdata), void *userdata);
+void         vfs_reload_update(); // main thread only
 
 #endif // FILE_H
 
@@ -105,6 +228,35 @@ char *file_load(const char *filename, int *len) { // @todo: fix leaks
 char *file_read(const char *filename) { // @todo: fix leaks
     return file_load(filename, NULL);
 }
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const char *file_mmap(const char *filename, int *len) {
+    const char *view = 0;
+    uint64_t sz = file_size(filename);
+    if( sz ) for( FILE *fp = fopen(filename, "rb"); fp; fclose(fp), fp = 0 ) {
+#ifdef _WIN32
+        HANDLE mapping = CreateFileMappingA((HANDLE)_get_osfhandle(_fileno(fp)), NULL, PAGE_READONLY, 0, 0, NULL);
+        if( mapping ) view = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)sz), CloseHandle(mapping);
+#else
+        void *ptr = mmap(0, (size_t)sz, PROT_READ, MAP_PRIVATE, fileno(fp), 0); // mapping outlives the descriptor
+        view = ptr == MAP_FAILED ? 0 : (const char *)ptr;
+#endif
+    }
+    if( len ) *len = view ? (int)sz : 0;
+    return view;
+}
+void file_munmap(const char *ptr, int len) {
+#ifdef _WIN32
+    if( ptr ) UnmapViewOfFile(ptr);
+#else
+    if( ptr ) munmap((void*)ptr, len);
+#endif
+}
 uint64_t file_stamp_human(const char *fname) {
     time_t mtime = (time_t)file_stamp(fname);
     struct tm *ti = localtime(&mtime);
@@ -122,6 +274,10 @@ bool file_directory( const char *pathfile ) {
     struct stat st;
     return stat(pathfile, &st) < 0 ? 0 : S_IFDIR == ( st.st_mode & S_IFMT );
 }
+const char *file_find( const char *pathfile ) {
+    struct stat st;
+    return pathfile && stat(pathfile, &st) == 0 && S_IFDIR != ( st.st_mode & S_IFMT ) ? pathfile : NULL;
+}
 char *file_normalize(const char *name) {
     char *copy = stringf("%s", name), *s = copy, c;
 #ifdef _WIN32
@@ -175,6 +331,9 @@ int qsort_strcmp(const void *a, const void *b) {
     const char **ib = (const char **)b;
     return strcmp(*ia, *ib);
 }
+static int qsort_strviewcmp(const void *a, const void *b) {
+    return strview_cmp(*(const strview *)a, *(const strview *)b);
+}
 char *file_id(const char *pathfile) {
     char *dir = file_path(pathfile); for(int i=0;dir[i];++i) dir[i]=tolower(dir[i]);
     char *base = file_name(pathfile); for(int i=0;base[i];++i) base[i]=tolower(base[i]);
@@ -195,59 +354,164 @@ char *ext = strchr(base, '.'); //if (ext) ext[0] = '\0'; // remove all extension
     int ids_count = 0;
     char ids[64][64];
     // split path stems
-    for each_substring(stem, "/\\", key) {
+    for each_strview(stem, "/\\", key) {
+        if( ids_count >= 64 ) break;
         int tokens_count = 0;
-        char *tokens[64];
+        strview tokens[64];
         // split tokens
-        for each_substring(key, "[]()_ ", it) {
+        for( strview src = key, it; tokens_count < 64 && strview_next(&src, "[]()_ ", &it); ) {
             tokens[tokens_count++] = it;
         }
         // sort alphabetically
-        if( tokens_count > 1 ) qsort(tokens, tokens_count, sizeof(char *), qsort_strcmp);
+        if( tokens_count > 1 ) qsort(tokens, tokens_count, sizeof(strview), qsort_strviewcmp);
         // concat sorted token1_token2_...
-        char built[256]; *built = 0;
-        for( int i = 0; i < tokens_count; ++i ) { strcat(built, "_"); strcat(built, tokens[i]); }
-        snprintf( ids[ ids_count ], 64, "%s", &built[1] );
+        int built = 0;
+        for( int i = 0; i < tokens_count && built < 63; ++i ) {
+            built += snprintf( ids[ ids_count ] + built, 64 - built, "%s%.*s", i ? "_" : "", tokens[i].len, tokens[i].ptr );
+        }
+        ids[ ids_count ][ built < 63 ? built : 63 ] = 0;
         len += strlen( ids[ ids_count++ ] );
     }
     // concat in inverse order: file/path1/path2/...
-    char buffer[512]; buffer[0] = 0;
-    for( int it = ids_count; --it >= 0; ) {
-        strcat(buffer, ids[it]);
-        strcat(buffer, "/");
+    char buffer[64 * 64 + 1]; buffer[0] = 0; // fits 64 ids of up to 63 chars each, plus slashes
+    for( int it = ids_count, built = 0; --it >= 0 && built < (int)sizeof(buffer) - 1; ) {
+        built += snprintf( buffer + built, sizeof(buffer) - built, "%s/", ids[it] );
     }
     return stringf("%s", buffer);
 }
-const char** file_list(const char *masks) {
-    static threadlocal array(char*) list = 0;
-    const char *arg0 = app_path();
-    int larg0 = strlen(arg0);
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+static int file__match(const char *pattern, const char *str) { // case-insensitive glob. '*' any run, '?' any char
+    const char *star = 0, *resume = 0;
+    while( *str ) {
+        if( *pattern == '*' ) { while( *pattern == '*' ) ++pattern; star = pattern, resume = str; continue; }
+        if( *pattern == '?' || tolower((unsigned char)*pattern) == tolower((unsigned char)*str) ) { ++pattern, ++str; continue; }
+        if( !star ) return 0;
+        pattern = star, str = ++resume;
+    }
+    while( *pattern == '*' ) ++pattern;
+    return !*pattern;
+}
+
+static void file__walk(array(file_info) *out, const char *dir, const char *pattern, int recurse) { // dir is "" or ends with '/'
+    char path[1024];
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    snprintf(path, sizeof(path), "%s*", dir);
+    HANDLE h = FindFirstFileA(path, &fd);
+    for( int ok = h != INVALID_HANDLE_VALUE; ok; ok = FindNextFileA(h, &fd) ) {
+        const char *name = fd.cFileName;
+        if( name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])) ) continue;
+        if( snprintf(path, sizeof(path), "%s%s", dir, name) >= sizeof(path) - 1 ) continue;
+        if( fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) {
+            if( recurse ) strcat(path, "/"), file__walk(out, path, pattern, recurse);
+            continue;
+        }
+        if( !file__match(pattern, name) ) continue;
+        file_info fi = {0};
+        fi.name = STRDUP(path);
+        fi.size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+        fi.stamp = ((((uint64_t)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime) - 116444736000000000ULL) / 10000000; // 100ns ticks since 1601 -> unix epoch
+        array_push(*out, fi);
+    }
+    if( h != INVALID_HANDLE_VALUE ) FindClose(h);
+#else
+    DIR *d = opendir(dir[0] ? dir : ".");
+    for( struct dirent *e; d && (e = readdir(d)); ) {
+        const char *name = e->d_name;
+        if( name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])) ) continue;
+        if( snprintf(path, sizeof(path), "%s%s", dir, name) >= sizeof(path) - 1 ) continue;
+        file_info fi = {0};
+        int is_dir = e->d_type == DT_DIR, is_file = e->d_type == DT_REG;
+        if( e->d_type == DT_UNKNOWN ) { // some filesystems do not fill d_type. symlinks are skipped, like find -type f did
+            struct stat st;
+            if( lstat(path, &st) < 0 ) continue;
+            is_dir = S_ISDIR(st.st_mode), is_file = S_ISREG(st.st_mode);
+            fi.size = st.st_size, fi.stamp = st.st_mtime;
+        }
+        if( is_dir ) {
+            if( recurse ) strcat(path, "/"), file__walk(out, path, pattern, recurse);
+            continue;
+        }
+        if( !is_file || !file__match(pattern, name) ) continue;
+        fi.name = STRDUP(path);
+        array_push(*out, fi);
+    }
+    if( d ) closedir(d);
+#endif
+}
+
+struct file__stat_args { file_info *list; int from, to; };
+static int file__stat(void *userdata) { // fills size and stamp of entries not stat'ed during the walk
+    struct file__stat_args *args = (struct file__stat_args *)userdata;
+    for( int i = args->from; i < args->to; ++i ) {
+        struct stat st;
+        if( !args->list[i].stamp && stat(args->list[i].name, &st) == 0 ) {
+            args->list[i].size = st.st_size, args->list[i].stamp = st.st_mtime;
+        }
+    }
+    return 0;
+}
+
+static int qsort_fileinfocmp(const void *a, const void *b) {
+    return strcmp(((const file_info *)a)->name, ((const file_info *)b)->name);
+}
+
+const file_info* file_scan(const char *masks, int *count) {
+    static threadlocal array(file_info) list = 0;
 
     for( int i = 0; i < array_count(list); ++i ) {
-        FREE(list[i]);
-    }
-    array_free(list);
-
-    for each_substring(masks,";",it) {
-        int recurse = !!strstr(it, "**");
-        #ifdef _WIN32
-        char *glob = stringf("dir %s /b/o:n %s", recurse ? "/s":"", it);
-        #else
-        char *glob = stringf("find ./ -type f \\( -iname \\%s \\) | sort", it); // @fixme: add non-recursive support
-        #endif
-        for( FILE *in = _popen(glob, "r"); in; _pclose(in), in = 0) {
-            char buf[1024], *line = buf;
-            while( fgets(buf, sizeof(buf), in) ) {
-                // clean up
-                if( strstr(line, arg0) ) line = buf + larg0;
-                if( !memcmp(line, "./", 2) ) line += 2;
-                int len = strlen(line); while( len > 0 && line[len-1] < 32 ) line[--len] = 0;
-                for(int i = 0; i < len; ++i ) if(line[i] == '\\') line[i] = '/';
-                // insert copy
-                char *copy = STRDUP(line);
-                array_push(list, copy);
-            }
+        FREE((void*)list[i].name);
+    }
+    array_clear(list);
+
+    for each_strview(masks,";",mask) {
+        // art/**.png -> walk art/ recursively, matching *.png filenames
+        char *it = strview_dup(mask), *slash = strrchr(it, '/');
+        const char *pattern = slash ? slash + 1 : it;
+        const char *dir = slash ? stringf("%.*s", (int)(pattern - it), it) : "";
+        while( !strncmp(dir, "./", 2) ) dir += 2;
+        int recurse = !!strstr(pattern, "**");
+
+        int from = array_count(list);
+        file__walk(&list, dir, pattern, recurse);
+        qsort(list + from, array_count(list) - from, sizeof(file_info), qsort_fileinfocmp);
+    }
+
+    // stat entries in parallel when the walk could not provide sizes and stamps (posix)
+    int numfiles = array_count(list);
+    int numthreads = numfiles < FILE_SCAN_MINPARALLEL ? 1 : FILE_SCAN_THREADS;
+    if( numthreads > 1 ) {
+        thread_ptr_t threads[64];
+        struct file__stat_args args[64];
+        if( numthreads > 64 ) numthreads = 64;
+        for( int i = 0; i < numthreads; ++i ) {
+            args[i].list = list;
+            args[i].from = (int)((int64_t)numfiles * i / numthreads);
+            args[i].to = (int)((int64_t)numfiles * (i+1) / numthreads);
+            threads[i] = thread_create(file__stat, &args[i], "file__stat()", 0);
         }
+        for( int i = 0; i < numthreads; ++i ) thread_join(threads[i]), thread_destroy(threads[i]);
+    } else {
+        struct file__stat_args args = { list, 0, numfiles };
+        file__stat(&args);
+    }
+
+    if( count ) *count = numfiles;
+    file_info zero = {0};
+    array_push(list, zero); // terminator
+    return list;
+}
+const char** file_list(const char *masks) {
+    static threadlocal array(const char*) list = 0;
+    array_clear(list);
+
+    int count;
+    const file_info *files = file_scan(masks, &count);
+    for( int i = 0; i < count; ++i ) {
+        array_push(list, files[i].name);
     }
     array_push(list, 0); // terminator
     return list;
@@ -267,6 +531,416 @@ bool file_copy(const char *src, const char *dst) {
     return ok;
 }
 
+// -----------------------------------------------------------------------------
+// batched reads
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int file__range(file_range *r) { // single blocking read. 1 if ok
+    r->data = 0, r->size = 0;
+    for( FILE *fp = fopen(r->pathfile, "rb"); fp; fclose(fp), fp = 0 ) {
+        int64_t len = r->len;
+        if( len < 0 ) fseek(fp, 0L, SEEK_END), len = ftell(fp) - r->offset;
+        if( len < 0 || fseek(fp, (long)r->offset, SEEK_SET) ) continue;
+        r->data = REALLOC(0, len + 1);
+        r->size = (int)fread(r->data, 1, len, fp);
+        r->data[r->size] = 0;
+        if( r->size != len ) REALLOC(r->data, 0), r->data = 0, r->size = 0;
+    }
+    return !!r->data;
+}
+
+struct file__batch_args {
+    file_range *ranges;
+    int count;
+    thread_atomic_int_t next, ok;
+};
+static int file__batch_thread(void *userdata) {
+    struct file__batch_args *args = (struct file__batch_args *)userdata;
+    for( int i; (i = thread_atomic_int_inc(&args->next)) < args->count; ) {
+        if( file__range(&args->ranges[i]) ) thread_atomic_int_inc(&args->ok);
+    }
+    return 0;
+}
+static int file__batch_threads(file_range *ranges, int count) {
+    struct file__batch_args args = { ranges, count };
+    thread_atomic_int_store(&args.next, 0);
+    thread_atomic_int_store(&args.ok, 0);
+
+    thread_ptr_t threads[64];
+    int numthreads = FILE_BATCH_THREADS < 64 ? FILE_BATCH_THREADS : 64;
+    if( numthreads > count ) numthreads = count;
+    for( int i = 1; i < numthreads; ++i ) threads[i] = thread_create(file__batch_thread, &args, "file__batch_thread()", 0);
+    file__batch_thread(&args); // calling thread works too
+    for( int i = 1; i < numthreads; ++i ) thread_join(threads[i]), thread_destroy(threads[i]);
+    return thread_atomic_int_load(&args.ok);
+}
+
+#if defined(__linux__) && FILE_BATCH_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+// minimal io_uring: raw syscalls, no liburing. one ring per batch
+typedef struct uring {
+    int fd;
+    unsigned entries, *sq_head, *sq_tail, *sq_mask, *sq_array, *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+} uring;
+
+static void uring_close(uring *r) {
+    if( r->sqes ) munmap(r->sqes, r->sqes_len);
+    if( r->cq_ptr && r->cq_ptr != r->sq_ptr ) munmap(r->cq_ptr, r->cq_len);
+    if( r->sq_ptr ) munmap(r->sq_ptr, r->sq_len);
+    if( r->fd >= 0 ) close(r->fd);
+}
+static int uring_open(uring *r, unsigned entries) {
+    uring zero = {0}; *r = zero;
+    struct io_uring_params p = {0};
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p); // ENOSYS, or EPERM in sandboxes
+    if( r->fd < 0 ) return 0;
+
+    r->entries = p.sq_entries;
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    int single = !!(p.features & IORING_FEAT_SINGLE_MMAP);
+    if( single ) r->sq_len = r->cq_len = r->sq_len > r->cq_len ? r->sq_len : r->cq_len;
+
+    r->sq_ptr = mmap(0, r->sq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq_ptr = single ? r->sq_ptr : mmap(0, r->cq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes = (struct io_uring_sqe *)mmap(0, r->sqes_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if( r->sq_ptr == MAP_FAILED ) r->sq_ptr = 0;
+    if( r->cq_ptr == MAP_FAILED ) r->cq_ptr = 0;
+    if( r->sqes == MAP_FAILED ) r->sqes = 0;
+    if( !r->sq_ptr || !r->cq_ptr || !r->sqes ) return uring_close(r), 0;
+
+    char *sq = (char*)r->sq_ptr, *cq = (char*)r->cq_ptr;
+    r->sq_head = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 1;
+}
+
+static int file__pread(int fd, file_range *f, int res) { // completes a read, from res bytes on. 1 if ok
+    while( res >= 0 && res < f->size ) {
+        int n = (int)pread(fd, f->data + res, f->size - res, f->offset + res);
+        res = n > 0 ? res + n : -1;
+    }
+    if( res == f->size ) return f->data[f->size] = 0, 1;
+    return REALLOC(f->data, 0), f->data = 0, f->size = 0, 0;
+}
+static int file__batch_uring(file_range *ranges, int count) { // <0 if io_uring is not available
+    uring r;
+    if( !uring_open(&r, FILE_BATCH_DEPTH) ) return -1;
+
+    // files are opened (and sized) synchronously, right before their reads get queued
+    int *fds = (int*)REALLOC(0, count * sizeof(int));
+    int next = 0, inflight = 0, done = 0, ok = 0;
+    while( done < count ) {
+        unsigned tail = *r.sq_tail, queued = 0;
+        while( next < count && inflight + queued < r.entries ) {
+            file_range *f = &ranges[next];
+            int fd = fds[next] = open(f->pathfile, O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            int64_t len = f->len < 0 && fd >= 0 && fstat(fd, &st) == 0 ? st.st_size - f->offset : f->len;
+            f->data = 0, f->size = 0;
+            if( fd < 0 || len < 0 || !(f->data = REALLOC(0, len + 1)) || !len ) {
+                if( f->data ) f->data[0] = 0, ++ok; // empty: nothing to read
+                if( fd >= 0 ) close(fd);
+                fds[next++] = -1, ++done;
+                continue;
+            }
+            f->size = (int)len; // expected. confirmed on completion
+
+            struct io_uring_sqe *sqe = &r.sqes[ (tail + queued) & *r.sq_mask ], zero = {0};
+            *sqe = zero;
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->off = (uint64_t)f->offset;
+            sqe->addr = (uint64_t)(uintptr_t)f->data;
+            sqe->len = (unsigned)len;
+            sqe->user_data = (uint64_t)next;
+            r.sq_array[ (tail + queued) & *r.sq_mask ] = (tail + queued) & *r.sq_mask;
+            ++queued, ++next;
+        }
+        __atomic_store_n(r.sq_tail, tail + queued, __ATOMIC_RELEASE);
+        inflight += queued;
+        if( !inflight ) continue;
+
+        unsigned unsubmitted = tail + queued - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE); // includes leftovers after EINTR
+        if( syscall(__NR_io_uring_enter, r.fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR ) {
+            // ring broke after setup: completions will not arrive, so finish in-flight reads here
+            for( int i = 0; i < next; ++i ) if( fds[i] >= 0 ) {
+                ok += file__pread(fds[i], &ranges[i], 0);
+                close(fds[i]), fds[i] = -1, ++done;
+            }
+            break;
+        }
+
+        unsigned head = *r.cq_head;
+        for( ; head != __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE); ++head, --inflight, ++done ) {
+            struct io_uring_cqe *cqe = &r.cqes[ head & *r.cq_mask ];
+            int i = (int)cqe->user_data, res = cqe->res;
+            ok += file__pread(fds[i], &ranges[i], res); // finishes short reads, if any
+            close(fds[i]), fds[i] = -1;
+        }
+        __atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    REALLOC(fds, 0);
+    uring_close(&r);
+    return next < count ? ok + file__batch_threads(ranges + next, count - next) : ok;
+}
+#endif
+
+int file_read_batch(file_range *ranges, int count) {
+    if( count <= 0 ) return 0;
+#if defined(__linux__) && FILE_BATCH_URING
+    int ok = file__batch_uring(ranges, count);
+    if( ok >= 0 ) return ok;
+#endif
+    return file__batch_threads(ranges, count);
+}
+
+// -----------------------------------------------------------------------------
+// watcher
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+static int file__masked(const char *masks, const char *path) { // same mask rules than file_scan()
+    for each_strview(masks,";",mask) {
+        char *it = strview_dup(mask), *slash = strrchr(it, '/');
+        const char *pattern = slash ? slash + 1 : it, *dir = it;
+        while( !strncmp(dir, "./", 2) ) dir += 2;
+        int dirlen = (int)(pattern - dir);
+        if( strncmp(path, dir, dirlen) ) continue;
+
+        const char *rest = path + dirlen, *name = strrchr(rest, '/');
+        if( name && !strstr(pattern, "**") ) continue;
+        if( file__match(pattern, name ? name + 1 : rest) ) return 1;
+    }
+    return 0;
+}
+
+static char *watcher_masks;
+static array(const char*) watcher_list;      // interned paths changed since last file_changes()
+typedef struct watcher_stamp { uint64_t stamp; unsigned scan; } watcher_stamp;
+static map(unsigned, watcher_stamp) watcher_stamps; // atom(path) -> stamp^size, and last scan seen. polled fallback
+static unsigned watcher_scans;
+static double watcher_polled;
+
+static void file__changed(const char *path) {
+    if( file_name(path)[0] == '.' || !file__masked(watcher_masks, path) ) return; // skip system/temp files
+    const char *atom = intern_str(intern(path));
+    for( int i = 0; i < array_count(watcher_list); ++i ) if( watcher_list[i] == atom ) return;
+    array_push(watcher_list, atom);
+}
+
+#ifdef __linux__
+static int watcher_fd = -1;
+static map(int, unsigned) watcher_dirs; // inotify descriptor -> atom(dir). "" or ending with '/'
+
+static int file__watching(const char *dir) { // 2: files in dir and its subdirs are masked ('**'), 1: files in dir only, 0: none
+    int watching = 0;
+    for each_strview(watcher_masks,";",mask) {
+        char *it = strview_dup(mask), *slash = strrchr(it, '/');
+        const char *pattern = slash ? slash + 1 : it, *base = it;
+        while( !strncmp(base, "./", 2) ) base += 2;
+        int baselen = (int)(pattern - base);
+        if( strncmp(dir, base, baselen) ) continue;
+        if( strstr(pattern, "**") ) return 2;
+        if( !dir[baselen] ) watching = 1;
+    }
+    return watching;
+}
+
+static void file__watchdir(const char *dir, int created) { // dir and those subdirs covered by masks. created dirs may have files already
+    if( !file__watching(dir) ) return;
+    int wd = inotify_add_watch(watcher_fd, dir[0] ? dir : ".", IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_DELETE|IN_CREATE);
+    if( wd < 0 ) return;
+    if( !map_find(watcher_dirs, wd) ) map_insert(watcher_dirs, wd, intern(dir));
+
+    DIR *d = opendir(dir[0] ? dir : ".");
+    for( struct dirent *e; d && (e = readdir(d)); ) {
+        if( e->d_name[0] == '.' && (!e->d_name[1] || (e->d_name[1] == '.' && !e->d_name[2])) ) continue;
+        char path[1024];
+        if( snprintf(path, sizeof(path), "%s%s/", dir, e->d_name) >= sizeof(path) - 1 ) continue;
+        struct stat st;
+        int is_dir = e->d_type == DT_DIR || (e->d_type == DT_UNKNOWN && lstat(path, &st) == 0 && S_ISDIR(st.st_mode));
+        if( is_dir ) file__watchdir(path, created);
+        else if( created ) path[strlen(path)-1] = 0, file__changed(path);
+    }
+    if( d ) closedir(d);
+}
+#endif
+
+void file_watch(const char *masks) {
+    FREE(watcher_masks);
+    watcher_masks = STRDUP(masks);
+    array_clear(watcher_list);
+
+#ifdef __linux__
+    if( watcher_fd >= 0 ) close(watcher_fd), map_clear(watcher_dirs);
+    if( !watcher_dirs ) map_init(watcher_dirs, less_int, hash_int);
+    watcher_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if( watcher_fd >= 0 ) {
+        for each_strview(masks,";",mask) {
+            char *it = strview_dup(mask), *slash = strrchr(it, '/');
+            const char *dir = slash ? stringf("%.*s", (int)(slash + 1 - it), it) : "";
+            while( !strncmp(dir, "./", 2) ) dir += 2;
+            file__watchdir(dir, 0);
+        }
+        return;
+    }
+#endif
+
+    // polled fallback: remember current stamps
+    if( !watcher_stamps ) map_init(watcher_stamps, less_int, hash_int);
+    map_clear(watcher_stamps);
+    int count;
+    const file_info *files = file_scan(masks, &count);
+    for( int i = 0; i < count; ++i ) {
+        watcher_stamp ws = { files[i].stamp ^ (files[i].size << 32), watcher_scans };
+        map_insert(watcher_stamps, intern(files[i].name), ws);
+    }
+    watcher_polled = time_ms();
+}
+
+const char** file_changes() {
+    array_clear(watcher_list);
+    if( !watcher_masks ) return array_push(watcher_list, 0), watcher_list;
+
+#ifdef __linux__
+    if( watcher_fd >= 0 ) {
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        for( int len; (len = (int)read(watcher_fd, buf, sizeof(buf))) > 0; ) {
+            for( char *ptr = buf; ptr < buf + len; ) {
+                const struct inotify_event *ev = (const struct inotify_event *)ptr;
+                ptr += sizeof(struct inotify_event) + ev->len;
+
+                unsigned *dir = map_find(watcher_dirs, ev->wd);
+                if( !dir || !ev->len ) continue;
+                const char *path = stringf("%s%s", intern_str(*dir), ev->name);
+                if( ev->mask & IN_ISDIR ) {
+                    if( ev->mask & (IN_CREATE|IN_MOVED_TO) ) file__watchdir(stringf("%s/", path), 1);
+                    continue;
+                }
+                if( ev->mask & IN_CREATE ) continue; // wait until written. IN_CLOSE_WRITE follows
+                file__changed(path);
+            }
+        }
+        array_push(watcher_list, 0);
+        return watcher_list;
+    }
+#endif
+
+    // polled fallback: rescan every FILE_WATCH_POLL_MS, and diff stamps
+    if( (time_ms() - watcher_polled) >= FILE_WATCH_POLL_MS ) {
+        watcher_polled = time_ms();
+
+        int count;
+        const file_info *files = file_scan(watcher_masks, &count);
+        ++watcher_scans;
+        for( int i = 0; i < count; ++i ) {
+            watcher_stamp ws = { files[i].stamp ^ (files[i].size << 32), watcher_scans }, *prev = map_find(watcher_stamps, intern(files[i].name));
+            if( !prev || prev->stamp != ws.stamp ) file__changed(files[i].name); // created or modified
+            if( prev ) *prev = ws; else map_insert(watcher_stamps, intern(files[i].name), ws);
+        }
+        array(unsigned) gone = 0;
+        for each_map(watcher_stamps, unsigned, k, watcher_stamp, v) {
+            if( v.scan != watcher_scans ) array_push(gone, k);
+        }
+        for( int i = 0; i < array_count(gone); ++i ) {
+            file__changed(intern_str(gone[i])); // deleted
+            map_erase(watcher_stamps, gone[i]);
+        }
+        array_free(gone);
+    }
+    array_push(watcher_list, 0);
+    return watcher_list;
+}
+
+// -----------------------------------------------------------------------------
+// decoded cache
+
+typedef struct file_cache_header {
+    char magic[4]; // "fwkd"
+    uint32_t version;
+    uint64_t key, size;
+    uint64_t reserved; // pads blobs to 16-byte alignment
+} file_cache_header;
+
+enum { FILE_CACHE_FORMAT = 1 }; // bump if header changes. decoders changing their output should change their params instead
+
+static const char *file_cache__path(uint64_t key) {
+    return stringf("%s%016llx", FILE_CACHE_DIR, (unsigned long long)key);
+}
+
+uint64_t file_cache_key(const void *src, int len, const char *params) {
+    // hash_bin() is stable on a given machine, which is all a local cache needs
+    uint64_t key = hash_bin(src, len) ^ hash_64(len);
+    return hash_64(key ^ hash_bin(params, strlen(params)));
+}
+const char *file_cache_load(uint64_t key, int *size) {
+    if( size ) *size = 0;
+    if( !FILE_CACHE_DIR[0] ) return 0;
+    int len = 0;
+    const char *view = file_mmap(file_cache__path(key), &len);
+    const file_cache_header *h = (const file_cache_header *)view;
+    if( view && (len < sizeof(*h) || memcmp(h->magic, "fwkd", 4) || h->version != FILE_CACHE_FORMAT || h->key != key || h->size != len - sizeof(*h)) ) {
+        file_munmap(view, len); // truncated or foreign file. next save replaces it
+        return 0;
+    }
+    if( view && size ) *size = len - sizeof(*h);
+    return view ? view + sizeof(*h) : 0;
+}
+void file_cache_unload(const char *blob, int size) {
+    if( blob ) file_munmap(blob - sizeof(file_cache_header), size + sizeof(file_cache_header));
+}
+bool file_cache_save(uint64_t key, const void *blob, int size) {
+    if( !FILE_CACHE_DIR[0] || !blob || size < FILE_CACHE_MIN ) return false;
+    static threadlocal int once;
+    if( !once ) {
+#ifdef _WIN32
+        mkdir(FILE_CACHE_DIR);
+#else
+        mkdir(FILE_CACHE_DIR, 0777);
+#endif
+        once = 1;
+    }
+    // write aside then rename, so readers never map a half-written blob. temp names are per thread
+    static threadlocal int tag;
+    const char *path = file_cache__path(key);
+    const char *temp = stringf("%s.%p.tmp", path, (void*)&tag);
+    file_cache_header h = { {'f','w','k','d'}, FILE_CACHE_FORMAT, key, (uint64_t)size };
+    bool ok = 0;
+    for( FILE *fp = fopen(temp, "wb"); fp; fp = 0 ) {
+        ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(blob, size, 1, fp) == 1;
+        ok &= fclose(fp) == 0;
+    }
+    if( ok ) {
+#ifdef _WIN32
+        remove(path); // rename() does not replace existing files here. if a concurrent saver wins, both wrote the same blob
+#endif
+        ok = rename(temp, path) == 0;
+    }
+    if( !ok ) remove(temp);
+    return ok;
+}
+
 // -----------------------------------------------------------------------------
 // archives
 
@@ -274,31 +948,95 @@ enum { is_zip, is_tar, is_pak, is_dir };
 
 typedef struct archive_dir {
     char* path;
-    union {
-        int type;
-        int size; // for cache only
-    };
+    const char *mount; // interned, as given to vfs_mount() (minus leading ./)
+    int type;
     union {
         void *archive;
-        void *data; // for cache only
         zip* zip_archive;
         tar* tar_archive;
         pak* pak_archive;
     };
+    thread_atomic_int_t *users; // located entries and streams still reading from archive. see vfs__retire()
     struct archive_dir *next;
 } archive_dir;
 
 static archive_dir *dir_mount;
-static archive_dir *dir_cache; enum { MAX_CACHED_FILES = 16 }; // @todo: should we cache the cooked contents instead? ie, stbi() result instead of file.png?
+static array(archive_dir) vfs_retired; // archives superseded by vfs_remount(), closed by cache_frame() once unused
 
 struct vfs_entry {
-    const char *name;
-    const char *id;
+    const char *name; // interned
+    const char *id; // interned
     unsigned size;
+    unsigned id_atom;
 };
 array(struct vfs_entry) vfs_entries;
 
+// vfs_entries index, extended at mount time and rebuilt on remount. later mounts overwrite earlier keys (last mount wins)
+static map(unsigned, int) vfs_index_ids;      // atom(file_id) -> entry
+static map(unsigned, int) vfs_index_paths;    // atom(name) -> entry
+static map(uint64_t, int) vfs_index_stems;    // hash(file_id prefix, up to any '/') -> entry. fuzzy lookups
+static map(unsigned, unsigned) vfs_resolved;  // atom(request) -> atom(resolved name). fuzzy results; flushed on mount
+
+// one-time inits, safe when several threads race for them. state: 0 uninit, 1 initializing, 2 ready
+static void vfs__once(thread_atomic_int_t *state, void (*init)(void)) {
+    if( thread_atomic_int_load(state) == 2 ) return;
+    if( thread_atomic_int_compare_and_swap(state, 0, 1) == 0 ) init(), thread_atomic_int_store(state, 2);
+    while( thread_atomic_int_load(state) != 2 ) thread_yield();
+}
+
+// mounts and indexes are shared by all threads. reentrant, as vfs calls nest (ie, vfs_map -> vfs_load).
+// held while resolving and locating entries only: extraction and cache run outside of it
+static thread_mutex_t vfs_mutex;
+static thread_atomic_int_t vfs_mutex_ready;
+static threadlocal int vfs_depth; // nesting of calling thread. only the outermost call locks
+
+static void vfs__mutex_init() {
+    thread_mutex_init(&vfs_mutex);
+}
+static void vfs_lock() {
+    vfs__once(&vfs_mutex_ready, vfs__mutex_init);
+    if( !vfs_depth++ ) thread_mutex_lock(&vfs_mutex);
+}
+static void vfs_unlock() {
+    if( !--vfs_depth ) thread_mutex_unlock(&vfs_mutex);
+}
+
+static void vfs__index(archive_dir *dir) { // appends dir listing to vfs_entries, and indexes it
+    assert(dir->type >= 0 && dir->type < 4);
+    unsigned (*fn_count[4])(void*) = {zip_count, tar_count, pak_count, dir_count};
+    char*    (*fn_name[4])(void*, unsigned index) = {zip_name, tar_name, pak_name, dir_name};
+    unsigned (*fn_size[4])(void*, unsigned index) = {zip_size, tar_size, pak_size, dir_size};
+
+    for( unsigned idx = 0, end = fn_count[dir->type](dir->archive); idx < end; ++idx ) {
+        assert(idx < end);
+        const char *filename = intern_str( intern(fn_name[dir->type](dir->archive, idx)) );
+        unsigned fileid = intern( file_id(filename) );
+        unsigned filesize = fn_size[dir->type](dir->archive, idx);
+        // printf("%u) %s %u [%s]\n", idx, filename, filesize, intern_str(fileid));
+        // append to list
+        array_push(vfs_entries, (struct vfs_entry){filename, intern_str(fileid), filesize, fileid});
+        // index it
+        map_insert(vfs_index_ids, fileid, array_count(vfs_entries) - 1);
+        map_insert(vfs_index_paths, intern(filename), array_count(vfs_entries) - 1);
+        const char *stem = intern_str(fileid);
+        for( const char *slash = strchr(stem, '/'); slash && slash[1]; slash = strchr(slash + 1, '/') ) {
+            map_insert(vfs_index_stems, hash_bin(stem, slash - stem + 1), array_count(vfs_entries) - 1);
+        }
+    }
+}
+
+static void vfs__reindex(archive_dir *dir) { // indexes dir and all older mounts, oldest first, so last mount still wins
+    if( dir ) vfs__reindex(dir->next), vfs__index(dir);
+}
+
+static bool vfs__mount(const char *path);
 bool vfs_mount(const char *path) {
+    vfs_lock();
+    bool ok = vfs__mount(path);
+    return vfs_unlock(), ok;
+}
+static
+bool vfs__mount(const char *path) {
     zip *z = NULL; tar *t = NULL; pak *p = NULL;
     int is_folder = ('/' == path[strlen(path)-1]);
     if( !is_folder ) z = zip_open(path, "rb");
@@ -308,6 +1046,7 @@ bool vfs_mount(const char *path) {
 
     // normalize input -> "././" to ""
     while (path[0] == '.' && path[1] == '/') path += 2;
+    const char *mount = intern_str(intern(path));
     path = STRDUP(path);
     if( z || t || p ) {
     // save local path for archives, so we can subtract those from upcoming requests
@@ -319,77 +1058,284 @@ bool vfs_mount(const char *path) {
     *(dir_mount = REALLOC(0, sizeof(archive_dir))) = zero;
     dir_mount->next = prev;
     dir_mount->path = (char*)path;
+    dir_mount->mount = mount;
     dir_mount->archive = z ? (void*)z : t ? (void*)t : (void*)p;
     dir_mount->type = is_folder ? is_dir : z ? is_zip : t ? is_tar : p ? is_pak : -1;
+    dir_mount->users = REALLOC(0, sizeof(thread_atomic_int_t));
+    thread_atomic_int_store(dir_mount->users, 0);
     ASSERT(dir_mount->type >= 0 && dir_mount->type < 4);
 
+    if( !vfs_index_ids ) {
+        map_init(vfs_index_ids, less_int, hash_int);
+        map_init(vfs_index_paths, less_int, hash_int);
+        map_init(vfs_index_stems, less_u64, hash_64);
+        map_init(vfs_resolved, less_int, hash_int);
+    }
+
     // append list of files to internal listing
-    for( archive_dir *dir = dir_mount; dir ; dir = 0 ) { // for(archive_dir *dir = dir_mount; dir; dir = dir->next) {
-        assert(dir->type >= 0 && dir->type < 4);
-        unsigned (*fn_count[4])(void*) = {zip_count, tar_count, pak_count, dir_count};
-        char*    (*fn_name[4])(void*, unsigned index) = {zip_name, tar_name, pak_name, dir_name};
-        unsigned (*fn_size[4])(void*, unsigned index) = {zip_size, tar_size, pak_size, dir_size};
+    vfs__index(dir_mount);
+
+    map_clear(vfs_resolved);
+    return 1;
+}
+
+// -----------------------------------------------------------------------------
+// hot-reload
+
+static void cache__drop(const char *key);
 
-        for( unsigned idx = 0, end = fn_count[dir->type](dir->archive); idx < end; ++idx ) {
-            assert(idx < end);
-            const char *filename = STRDUP( fn_name[dir->type](dir->archive, idx) );
-            const char *fileid = STRDUP( file_id(filename) );
-            unsigned filesize = fn_size[dir->type](dir->archive, idx);
-            // printf("%u) %s %u [%s]\n", idx, filename, filesize, fileid);
-            // append to list
-            array_push(vfs_entries, (struct vfs_entry){filename, fileid, filesize});
+typedef struct vfs_reloader {
+    unsigned atom; // pathfile, as registered
+    void (*callback)(const char *pathfile, void *userdata);
+    void *userdata;
+} vfs_reloader;
+
+static array(vfs_reloader) vfs_reloaders;
+static array(unsigned) vfs_reloads; // atom(changed name). pending for vfs_reload_update()
+
+bool vfs_remount(const char *mount_point, const char **changed) {
+    while (mount_point[0] == '.' && mount_point[1] == '/') mount_point += 2;
+
+    vfs_lock();
+    archive_dir *dir = dir_mount;
+    while( dir && dir->mount != intern_str(intern(mount_point)) ) dir = dir->next;
+
+    bool ok = 1;
+    if( !dir ) ok = vfs__mount(mount_point); // not mounted before (ie, archive did not exist yet)
+    else if( dir->type != is_dir ) {
+        // old archive is retired rather than closed, as zero-copy views from vfs_map() may still point into it.
+        // listing is rebuilt from scratch, so entries deleted from the archive do not resolve anymore.
+        void *archive = dir->type == is_zip ? (void*)zip_open(mount_point, "rb") : dir->type == is_tar ? (void*)tar_open(mount_point, "rb") : (void*)pak_open(mount_point, "rb");
+        if( archive ) {
+            array_push(vfs_retired, *dir);
+            dir->archive = archive;
+            dir->users = REALLOC(0, sizeof(thread_atomic_int_t));
+            thread_atomic_int_store(dir->users, 0);
+            array_clear(vfs_entries);
+            map_clear(vfs_index_ids);
+            map_clear(vfs_index_paths);
+            map_clear(vfs_index_stems);
+            vfs__reindex(dir_mount);
         }
+        ok = !!archive;
     }
 
-    return 1;
+    for( int i = 0; changed && changed[i]; ++i ) {
+        unsigned atom = intern(changed[i]);
+        cache__drop(changed[i]);
+        int queued = 0;
+        for( int j = 0; j < array_count(vfs_reloads) && !queued; ++j ) queued = vfs_reloads[j] == atom;
+        if( !queued ) array_push(vfs_reloads, atom);
+    }
+    map_clear(vfs_resolved);
+    vfs_unlock();
+    return ok;
 }
 
-static
-char *vfs_unpack(const char *pathfile, int *size) { // must free() after use
-    // @todo: add cache here
-    char *data = NULL;
-    for(archive_dir *dir = dir_mount; dir && !data; dir = dir->next) {
-        if( dir->type == is_dir ) {
-#if 0 // sandboxed
-            char buf[512];
-            snprintf(buf, sizeof(buf), "%s%s", dir->path, pathfile);
-            data = file_load(buf, size);
-#endif
-        } else {
-            int   (*fn_find[3])(void *, const char *) = {zip_find, tar_find, pak_find};
-            void* (*fn_unpack[3])(void *, unsigned) = {zip_extract, tar_extract, pak_extract};
-            int   (*fn_size[3])(void *, unsigned) = {zip_size, tar_size, pak_size};
+static void vfs__retire() { // closes superseded archives nobody reads from anymore. views from vfs_map() expire along with the frame
+    vfs_lock();
+    for( int i = array_count(vfs_retired); --i >= 0; ) {
+        archive_dir *dir = &vfs_retired[i];
+        if( thread_atomic_int_load(dir->users) ) continue; // extraction or stream in flight. retry next frame
+
+        /**/ if( dir->type == is_zip ) zip_close(dir->zip_archive);
+        else if( dir->type == is_tar ) tar_close(dir->tar_archive);
+        else if( dir->type == is_pak ) pak_close(dir->pak_archive);
+        REALLOC(dir->users, 0);
+        vfs_retired[i] = vfs_retired[array_count(vfs_retired) - 1];
+        array_pop(vfs_retired);
+    }
+    vfs_unlock();
+}
+
+void vfs_reload(const char *pathfile, void (*callback)(const char *pathfile, void *userdata), void *userdata) {
+    vfs_reloader r = { intern(pathfile), callback, userdata };
+    vfs_lock();
+    int found = 0;
+    for( int i = 0; i < array_count(vfs_reloaders) && !found; ++i ) {
+        found = !memcmp(&vfs_reloaders[i], &r, sizeof(vfs_reloader));
+    }
+    if( !found ) array_push(vfs_reloaders, r);
+    vfs_unlock();
+}
+void vfs_reload_off(const char *pathfile, void (*callback)(const char *pathfile, void *userdata), void *userdata) {
+    vfs_reloader r = { intern(pathfile), callback, userdata };
+    vfs_lock();
+    for( int i = array_count(vfs_reloaders); --i >= 0; ) {
+        if( !memcmp(&vfs_reloaders[i], &r, sizeof(vfs_reloader)) ) {
+            vfs_reloaders[i] = vfs_reloaders[array_count(vfs_reloaders) - 1];
+            array_pop(vfs_reloaders);
+        }
+    }
+    vfs_unlock();
+}
+void vfs_reload_update() {
+    if( !vfs_reloads ) return;
+
+    vfs_lock();
+    array(unsigned) pending = vfs_reloads;
+    vfs_reloads = 0;
+    vfs_unlock();
 
-            const char* cleanup = pathfile + strbegini(pathfile, dir->path) * strlen(dir->path);
-            while (cleanup[0] == '/') ++cleanup;
-            int index = fn_find[dir->type](dir->archive, cleanup);
-            data = fn_unpack[dir->type](dir->archive, index);
-            if( size ) *size = fn_size[dir->type](dir->archive, index);
+    for( int i = 0; i < array_count(pending); ++i ) {
+        // callbacks may register (or unregister) reloaders, so walk it by index and copy
+        for( int j = 0; j < array_count(vfs_reloaders); ++j ) {
+            vfs_reloader r = vfs_reloaders[j];
+            const char *pathfile = intern_str(r.atom);
+            if( r.atom != pending[i] && intern(vfs_resolve(pathfile)) != pending[i] ) continue;
+            PRINTF("Reloading %s\n", pathfile);
+            r.callback(pathfile, r.userdata);
         }
-        // printf("%c trying %s in %s ...\n", data ? 'Y':'N', pathfile, dir->path);
+    }
+    array_free(pending);
+}
+
+// archive entries found by vfs__locate(). located entries count as users of their archive until vfs__done(),
+// so they can be extracted after unlocking, and by many threads at once, even if a remount retires the archive meanwhile.
+typedef struct vfs_located {
+    void *archive;
+    const char *mount; // archive file
+    int type, index;   // type < 0 if not found
+    thread_atomic_int_t *users;
+} vfs_located;
+
+static
+vfs_located vfs__locate(const char *pathfile) { // vfs lock held
+    vfs_located found = { 0, 0, -1, -1 };
+    for(archive_dir *dir = dir_mount; dir && found.type < 0; dir = dir->next) {
+        if( dir->type == is_dir ) continue; // sandboxed
+        int (*fn_find[3])(void *, const char *) = {zip_find, tar_find, pak_find};
+
+        const char* cleanup = pathfile + strbegini(pathfile, dir->path) * strlen(dir->path);
+        while (cleanup[0] == '/') ++cleanup;
+        int index = fn_find[dir->type](dir->archive, cleanup);
+        if( index >= 0 ) found.archive = dir->archive, found.mount = dir->mount, found.type = dir->type, found.index = index, found.users = dir->users;
+        // printf("%c trying %s in %s ...\n", index >= 0 ? 'Y':'N', pathfile, dir->path);
+    }
+    if( found.users ) thread_atomic_int_inc(found.users);
+    return found;
+}
+static
+void vfs__done(vfs_located *e) { // lock-free. releases a located entry
+    if( e->users ) thread_atomic_int_dec(e->users), e->users = 0;
+}
+static
+char *vfs__extract(vfs_located e, int *size) { // lock-free. must free() after use
+    if( e.type < 0 ) return 0;
+    void* (*fn_unpack[3])(void *, unsigned) = {zip_extract, tar_extract, pak_extract};
+    int   (*fn_size[3])(void *, unsigned) = {zip_size, tar_size, pak_size};
+
+    char *data = fn_unpack[e.type](e.archive, e.index);
+    if( data ) {
+        int len = fn_size[e.type](e.archive, e.index);
+        data = REALLOC(data, len+1), data[len] = 0; // tar/pak extractors do not terminate
+        if( size ) *size = len;
     }
     //wait_ms(1000); // <-- simulate slow hdd
     return data;
 }
 
+// load traces. cooker lays archives out in this order, so cold loads read them mostly sequentially
+static FILE *vfs_tracefile;
+static map(unsigned, int) vfs_traced;
+
+void vfs_trace(const char *logfile) {
+    vfs_lock();
+    if( vfs_tracefile ) fclose(vfs_tracefile), vfs_tracefile = 0;
+    if( vfs_traced ) map_clear(vfs_traced);
+    if( logfile ) vfs_tracefile = fopen(logfile, "wb");
+    vfs_unlock();
+}
+static
+void vfs__trace(const char *pathfile) { // first touch only. flushed, so traces survive crashes
+    if( !vfs_tracefile ) return;
+    if( !vfs_traced ) map_init(vfs_traced, less_int, hash_int);
+    unsigned atom = intern(pathfile);
+    if( map_find(vfs_traced, atom) ) return;
+    map_insert(vfs_traced, atom, 1);
+    fprintf(vfs_tracefile, "%s\n", pathfile);
+    fflush(vfs_tracefile);
+}
+
+static const char *vfs__map(const char *pathfile, int *size);
+const char *vfs_map(const char *pathfile, int *size) {
+    vfs_lock();
+    const char *view = vfs__map(pathfile, size);
+    vfs_unlock();
+    return view ? view : vfs_load(pathfile, size); // compressed or not a zip
+}
+static
+const char *vfs__map(const char *pathfile, int *size) {
+    // solve virtual path
+    const char *resolved = vfs_resolve(pathfile);
+    while (resolved[0] == '.' && resolved[1] == '/') resolved += 2;
+    while (resolved[0] == '/') ++resolved;
+
+    // search (mounted disks). same priority than vfs__locate(), but only stored zip entries are viewable
+    for(archive_dir *dir = dir_mount; dir; dir = dir->next) {
+        if( dir->type == is_dir ) continue;
+        int (*fn_find[3])(void *, const char *) = {zip_find, tar_find, pak_find};
+
+        const char* cleanup = resolved + strbegini(resolved, dir->path) * strlen(dir->path);
+        while (cleanup[0] == '/') ++cleanup;
+        int index = fn_find[dir->type](dir->archive, cleanup);
+        if( index < 0 ) continue;
+
+        const char *view = dir->type == is_zip ? zip_peek(dir->zip_archive, index) : NULL;
+        if( !view ) break; // compressed or not a zip. vfs_map() loads it
+        if( size ) *size = zip_size(dir->zip_archive, index);
+        vfs__trace(resolved);
+        return view;
+    }
+
+    return 0;
+}
+
+static const char *vfs__resolve(const char *pathfile);
 const char *vfs_resolve(const char *pathfile) {
+    vfs_lock();
+    const char *name = vfs__resolve(pathfile);
+    return vfs_unlock(), name;
+}
+static
+const char *vfs__resolve(const char *pathfile) {
     // we dont resolve absolute paths. they dont belong to the vfs
     if( pathfile[0] == '/' || pathfile[0] == '\\' || pathfile[1] == ':' ) return pathfile;
 
-    // find best match
+    if( !vfs_index_ids ) return pathfile;
+
+    // find exact path
+    unsigned atom = interned(pathfile);
+    int *found = atom ? map_find(vfs_index_paths, atom) : 0;
+    if( found ) return vfs_entries[*found].name;
+
+    // find previous resolution
+    unsigned *resolved = atom ? map_find(vfs_resolved, atom) : 0;
+    if( resolved ) return intern_str(*resolved);
+
+    // find exact match
     char* id = file_id(pathfile);
-    for (int i = array_count(vfs_entries); --i >= 0; ) {
+    unsigned id_atom = interned(id);
+    found = id_atom ? map_find(vfs_index_ids, id_atom) : 0;
+    const char *name = found ? vfs_entries[*found].name : 0;
+
+    // find best match. file_id()s end with '/', so matches happen at path component boundaries
+    found = name ? 0 : map_find(vfs_index_stems, hash_bin(id, strlen(id)));
+    if( found && strbegini(vfs_entries[*found].id, id) ) name = vfs_entries[*found].name;
+    for (int i = array_count(vfs_entries); !name && --i >= 0; ) {
         if (strbegini(vfs_entries[i].id, id) ) {
-            return vfs_entries[i].name;
+            name = vfs_entries[i].name;
         }
     }
 
-    return pathfile;
+    // remember it. misses too, so repeated requests skip the linear scan
+    unsigned result = intern(name ? name : pathfile);
+    map_insert(vfs_resolved, intern(pathfile), result);
+    return intern_str(result);
 }
 
-char* vfs_load(const char *pathfile, int *size_out) { // @todo: fix leaks
-    if (pathfile[0] == '/' || pathfile[1] == ':') return file_load(pathfile, size_out);
-
+static
+const char *vfs__name(const char *pathfile) { // resolved and cleaned pathfile, as hashed by cache
     {
     // exclude garbage from material names
     // @todo: exclude double slashs in paths
@@ -404,59 +1350,240 @@ char* vfs_load(const char *pathfile, int *size_out) { // @todo: fix leaks
     PRINTF("Loading VFS: (%s)%s\n", folder, base);
     }
 
-    int size = 0;
-    void *ptr = 0;
-
     // clean pathfile
     while (pathfile[0] == '.' && pathfile[1] == '/') pathfile += 2;
     while (pathfile[0] == '/') ++pathfile;
+    return pathfile;
+}
+static void* cache__get(const char *key, int *size, int pin);
+static void* cache__put(const char *key, void *value, int size, int pin);
 
-    const char *lookup_id = /*file_normalize_with_folder*/(pathfile);
-
-    // search (last item)
-    static char last_item[256] = { 0 };
-    static void *last_ptr = 0;
-    static int   last_size = 0;
-    if( !strcmpi(lookup_id, last_item)) {
-        ptr = last_ptr;
-        size = last_size;
+static
+char *vfs__load(const char *pathfile, int *size_out, int pin) {
+    // resolve and locate under vfs lock. cache and extraction run concurrently
+    int absolute = pathfile[0] == '/' || pathfile[1] == ':';
+    vfs_located entry = { 0, 0, -1, -1 };
+    if( !absolute ) {
+        vfs_lock();
+        pathfile = vfs__name(pathfile);
+        entry = vfs__locate(pathfile);
+        if( entry.type >= 0 ) vfs__trace(pathfile);
+        vfs_unlock();
     }
 
+    int size = 0;
+    void *ptr = 0;
+
+    const char *lookup_id = /*file_normalize_with_folder*/(pathfile);
+
     // search (cache)
-    if( !ptr ) {
-        ptr = cache_lookup(lookup_id, &size);
-        if( ptr ) {
-            PRINTF("Hit cache %s\n", pathfile);
-        }
+    ptr = cache__get(lookup_id, &size, pin);
+    if( ptr ) {
+        PRINTF("Hit cache %s\n", pathfile);
     }
 
-    // search (mounted disks)
+    // search (mounted disks). cache owns the buffer from now on; if another thread inserted it meanwhile, theirs is kept
     if( !ptr ) {
-        ptr = vfs_unpack(pathfile, &size);
+        ptr = absolute ? file_load(pathfile, &size) : vfs__extract(entry, &size);
         if( ptr ) {
-            cache_insert(lookup_id, ptr, size);
+            ptr = cache__put(lookup_id, ptr, size, pin);
         } else {
             PRINTF("Loading %s (not found)\n", pathfile);
         }
     }
-
-    if (ptr != last_ptr) {
-        snprintf(last_item, 256, "%s", lookup_id);
-        last_ptr = ptr;
-        last_size = size;
-    }
+    vfs__done(&entry);
 
     if( size_out ) *size_out = ptr ? size : 0;
     return ptr;
 }
+char* vfs_load(const char *pathfile, int *size_out) { // do not free. valid until next frame
+    if (pathfile[0] == '/' || pathfile[1] == ':') return file_load(pathfile, size_out);
+    return vfs__load(pathfile, size_out, 0);
+}
+char* vfs_acquire(const char *pathfile, int *size_out) {
+    return vfs__load(pathfile, size_out, 1);
+}
+void vfs_release(const char *pathfile) {
+    if( !(pathfile[0] == '/' || pathfile[1] == ':') ) {
+        vfs_lock();
+        pathfile = vfs__name(pathfile);
+        vfs_unlock();
+    }
+    cache_release(pathfile);
+}
 char* vfs_read(const char *pathfile) {
     return vfs_load(pathfile, NULL);
 }
 int vfs_size(const char *pathfile) { // this is sub-optimal at the moment
-    int sz;
-    return vfs_load(pathfile, &sz), sz;
+    int sz = 0;
+    if( vfs_acquire(pathfile, &sz) ) vfs_release(pathfile);
+    return sz;
+}
+int vfs_load_batch(const char **pathfiles, int count, char **data, int *sizes) {
+    struct vfs_batched {
+        int owner;          // index into pathfiles
+        char *key;          // cache key
+        int range;          // index into ranges, or <0 for zip entries
+        vfs_located entry;
+    };
+    array(struct vfs_batched) queued = 0;
+    array(file_range) ranges = 0;
+    int found = 0;
+
+    // cache hits are solved here. disk files and tar/pak entries get queued as ranges, and zip entries for extraction
+    vfs_lock();
+    for( int i = 0; i < count; ++i ) {
+        const char *pathfile = pathfiles[i];
+        int size = 0;
+
+        // absolute paths are read from disk, but cached anyway so the buffers have an owner
+        int absolute = pathfile[0] == '/' || pathfile[1] == ':';
+        if( !absolute ) pathfile = vfs__name(pathfile);
+
+        data[i] = cache_lookup(pathfile, &size);
+        if( sizes ) sizes[i] = data[i] ? size : 0;
+        found += !!data[i];
+        if( data[i] ) continue;
+
+        struct vfs_batched q = { i, 0, -1, { 0, pathfile, -1, -1 } };
+        if( !absolute ) q.entry = vfs__locate(pathfile);
+        if( !absolute && q.entry.type < 0 ) continue;
+
+        if( q.entry.type != is_zip ) {
+            file_range r = { q.entry.mount, 0, -1 };
+            if( q.entry.type == is_tar ) r.offset = tar_offset(q.entry.archive, q.entry.index), r.len = tar_size(q.entry.archive, q.entry.index);
+            if( q.entry.type == is_pak ) r.offset = pak_offset(q.entry.archive, q.entry.index), r.len = pak_size(q.entry.archive, q.entry.index);
+            q.range = array_count(ranges);
+            array_push(ranges, r);
+        }
+        q.key = STRDUP(pathfile);
+        array_push(queued, q);
+        if( !absolute ) vfs__trace(pathfile);
+    }
+    vfs_unlock();
+
+    // read queued ranges at once. zip entries are mapped, so they only cost decompression
+    file_read_batch(ranges, array_count(ranges));
+
+    for( int j = 0; j < array_count(queued); ++j ) {
+        struct vfs_batched *q = &queued[j];
+        int size = 0;
+        char *ptr = q->range >= 0 ? ranges[q->range].data : vfs__extract(q->entry, &size);
+        if( q->range >= 0 ) size = ranges[q->range].size;
+        data[q->owner] = ptr ? cache_insert(q->key, ptr, size) : 0;
+        if( sizes ) sizes[q->owner] = ptr ? size : 0;
+        found += !!ptr;
+        vfs__done(&q->entry);
+        FREE(q->key);
+    }
+
+    array_free(queued);
+    array_free(ranges);
+    return found;
 }
 
+struct vfs_file {
+    FILE *fp;         // disk file, or archive file shared with its mount (tar/pak). positional reads only
+    const char *mem;  // mapped zip entry, or decompressed copy (owned)
+    int owned;        // fclose(fp) or FREE(mem) when done
+    int64_t base, size, pos;
+    thread_atomic_int_t *users; // of the archive fp/mem belong to, if not owned
+};
+
+static vfs_file *vfs__fopen(const char *pathfile, vfs_located *unpack);
+vfs_file *vfs_fopen(const char *pathfile) {
+    vfs_located unpack = { 0, 0, -1, -1 };
+    vfs_lock();
+    vfs_file *f = vfs__fopen(pathfile, &unpack);
+    vfs_unlock();
+
+    // compressed zip entries get decompressed out of the lock
+    if( f && unpack.type >= 0 ) {
+        f->mem = vfs__extract(unpack, 0), f->owned = 1;
+        vfs__done(&unpack);
+        if( !f->mem ) REALLOC(f, 0), f = 0;
+    }
+    return f;
+}
+static
+vfs_file *vfs__fopen(const char *pathfile, vfs_located *unpack) {
+    vfs_file zero = {0}, f = zero;
+
+    // we dont resolve absolute paths. they dont belong to the vfs
+    int absolute = pathfile[0] == '/' || pathfile[0] == '\\' || pathfile[1] == ':';
+    const char *resolved = absolute ? pathfile : vfs_resolve(pathfile);
+    while (resolved[0] == '.' && resolved[1] == '/') resolved += 2;
+    while (!absolute && resolved[0] == '/') ++resolved;
+
+    // search (mounted disks), same priority than vfs__locate()
+    if( !absolute )
+    for(archive_dir *dir = dir_mount; dir && !f.fp && !f.mem && unpack->type < 0; dir = dir->next) {
+        if( dir->type == is_dir ) continue;
+        int (*fn_find[3])(void *, const char *) = {zip_find, tar_find, pak_find};
+
+        const char* cleanup = resolved + strbegini(resolved, dir->path) * strlen(dir->path);
+        while (cleanup[0] == '/') ++cleanup;
+        int index = fn_find[dir->type](dir->archive, cleanup);
+        if( index < 0 ) continue;
+
+        /**/ if( dir->type == is_zip ) {
+            f.size = zip_size(dir->zip_archive, index);
+            f.mem = zip_peek(dir->zip_archive, index);
+            if( !f.mem ) unpack->archive = dir->archive, unpack->mount = dir->mount, unpack->type = is_zip, unpack->index = index, unpack->users = dir->users;
+        }
+        else if( dir->type == is_tar ) {
+            f.fp = dir->tar_archive->in, f.base = tar_offset(dir->tar_archive, index), f.size = tar_size(dir->tar_archive, index);
+        }
+        else if( dir->type == is_pak ) {
+            f.fp = dir->pak_archive->in, f.base = pak_offset(dir->pak_archive, index), f.size = pak_size(dir->pak_archive, index);
+        }
+        if( unpack->type < 0 ) f.users = dir->users;
+        thread_atomic_int_inc(dir->users); // until extracted, or until vfs_fclose()
+        vfs__trace(resolved);
+    }
+
+    // search (disk)
+    if( !f.fp && !f.mem && unpack->type < 0 ) {
+        f.fp = fopen(pathfile, "rb");
+        if( !f.fp ) return 0;
+        f.owned = 1;
+        f.size = file_size(pathfile);
+    }
+
+    vfs_file *ret = REALLOC(0, sizeof(vfs_file));
+    return *ret = f, ret;
+}
+int vfs_fread(vfs_file *f, void *buf, int len) {
+    if( len > f->size - f->pos ) len = (int)(f->size - f->pos);
+    if( len <= 0 ) return 0;
+    if( f->mem ) {
+        memcpy(buf, f->mem + f->pos, len);
+    } else {
+        len = archive__pread(f->fp, buf, len, f->base + f->pos) ? len : 0; // archive handles are shared: never seek
+    }
+    f->pos += len;
+    return len;
+}
+int vfs_fseek(vfs_file *f, int64_t offset, int whence) {
+    int64_t pos = whence == SEEK_SET ? offset : whence == SEEK_CUR ? f->pos + offset : f->size + offset;
+    if( pos < 0 || pos > f->size ) return -1;
+    f->pos = pos;
+    return 0;
+}
+int64_t vfs_ftell(vfs_file *f) {
+    return f->pos;
+}
+int64_t vfs_fsize(vfs_file *f) {
+    return f->size;
+}
+void vfs_fclose(vfs_file *f) {
+    if( f->owned && f->fp ) fclose(f->fp);
+    if( f->owned && f->mem ) FREE((void*)f->mem);
+    if( f->users ) thread_atomic_int_dec(f->users);
+    vfs_file zero = {0};
+    *f = zero;
+    REALLOC(f, 0);
+}
 
 FILE* vfs_handle(const char *pathfile) { // preferred way, will clean descriptors at exit
     int sz;
@@ -465,78 +1592,544 @@ FILE* vfs_handle(const char *pathfile) { // preferred way, will clean descriptor
     ASSERT( fp, "cannot create tempfile" );
     return fp;
 }
-const char *vfs_handlename(const char *pathfile) {
-#if 0
-    FILE* fp = vfs_handle(pathfile);
-    return fp ? pathfile_from_handle(fp) : "";
+
+
+// -----------------------------------------------------------------------------
+// cache
+
+typedef struct cache_entry {
+    void *data;
+    int size, refs;
+    int epoch; // frame it was last handed out unpinned. kept until next frame
+    unsigned key;
+    struct cache_entry *prev, *next; // lru list: head is most recently used, tail is next to evict
+} cache_entry;
+
+// keys are spread across shards, each one with its own lock, lru list and slice of the budget
+typedef struct cache_shard {
+    thread_mutex_t mutex;
+    map(unsigned, cache_entry) entries;
+    cache_entry *head, *tail;
+    int64_t used;
+    int64_t hits, misses, evictions; // not profile_incstat(): loader threads get here too
+    array(void*) retired; // dropped while handed out this frame. freed next frame
+} cache_shard;
+
+static cache_shard cache_shards[CACHE_SHARDS];
+static thread_atomic_int_t cache_ready;
+static int64_t cache_limit = CACHE_BUDGET;
+static thread_atomic_int_t cache_epoch; // frame counter. bumped by cache_frame()
+
+static void cache__init() {
+    for( int i = 0; i < CACHE_SHARDS; ++i ) {
+        thread_mutex_init(&cache_shards[i].mutex);
+        map_init(cache_shards[i].entries, less_int, hash_int);
+    }
+}
+static cache_shard *cache__lock(unsigned key) {
+    vfs__once(&cache_ready, cache__init);
+    cache_shard *c = &cache_shards[ key % CACHE_SHARDS ];
+    thread_mutex_lock(&c->mutex);
+    return c;
+}
+static void cache__unlock(cache_shard *c) {
+    thread_mutex_unlock(&c->mutex);
+}
+
+static void cache__unlink(cache_shard *c, cache_entry *e) {
+    if( e->prev ) e->prev->next = e->next; else c->head = e->next;
+    if( e->next ) e->next->prev = e->prev; else c->tail = e->prev;
+    e->prev = e->next = 0;
+}
+static void cache__link(cache_shard *c, cache_entry *e) { // as most recently used
+    e->prev = 0, e->next = c->head;
+    if( c->head ) c->head->prev = e; else c->tail = e;
+    c->head = e;
+}
+static void cache__evict(cache_shard *c, int64_t incoming) {
+    // entries handed out this frame are skipped, unless shard is twice over budget (ie, no cache_frame() calls for a long while)
+    for( int hard = 0; hard < 2; ++hard ) {
+        int64_t limit = (cache_limit / CACHE_SHARDS) << hard;
+        for( cache_entry *e = c->tail, *prev; e && c->used + incoming > limit; e = prev ) {
+            prev = e->prev;
+            if( e->refs || (!hard && e->epoch == thread_atomic_int_load(&cache_epoch)) ) continue; // pinned, or handed out this frame
+            cache__unlink(c, e);
+            c->used -= e->size;
+            REALLOC(e->data, 0);
+            map_erase(c->entries, e->key);
+            c->evictions++;
+        }
+    }
+}
+static void cache__drop(const char *key) { // stale contents. pinned entries are kept until released
+    cache_shard *c = cache__lock(intern(key));
+    cache_entry *e = map_find(c->entries, intern(key));
+    if( e && !e->refs ) {
+        cache__unlink(c, e);
+        c->used -= e->size;
+        if( e->epoch == thread_atomic_int_load(&cache_epoch) ) array_push(c->retired, e->data);
+        else REALLOC(e->data, 0);
+        map_erase(c->entries, e->key);
+    }
+    cache__unlock(c);
+}
+static void* cache__get(const char *key, int *size, int pin) {
+    cache_shard *c = cache__lock(intern(key));
+    cache_entry *e = map_find(c->entries, intern(key));
+    if( e ) c->hits++; else c->misses++;
+    if( e && e != c->head ) cache__unlink(c, e), cache__link(c, e);
+    if( e && pin ) e->refs++;
+    if( e && !pin ) e->epoch = thread_atomic_int_load(&cache_epoch);
+    if( e && size ) *size = e->size;
+    void *data = e ? e->data : 0;
+    return cache__unlock(c), data;
+}
+static void* cache__put(const char *key, void *value, int size, int pin) { // pinned within same lock, so no other thread can evict it first
+    assert( value );
+    cache_shard *c = cache__lock(intern(key));
+
+    // already cached: keep the older buffer, as it may be in use
+    cache_entry *e = map_find(c->entries, intern(key));
+    if( e ) {
+        if( e->data != value ) REALLOC(value, 0);
+    } else {
+        cache__evict(c, size);
+
+        cache_entry zero = {0};
+        zero.epoch = -1; // not handed out yet
+        e = map_insert(c->entries, intern(key), zero);
+        e->key = intern(key);
+        e->data = value;
+        e->size = size;
+        cache__link(c, e);
+        c->used += size;
+    }
+    if( pin ) e->refs++;
+    else e->epoch = thread_atomic_int_load(&cache_epoch);
+    void *data = e->data;
+    return cache__unlock(c), data;
+}
+
+void* cache_lookup(const char *key, int *size) {
+    return cache__get(key, size, 0);
+}
+void* cache_acquire(const char *key, int *size) {
+    return cache__get(key, size, 1);
+}
+void cache_release(const char *key) {
+    cache_shard *c = cache__lock(intern(key));
+    cache_entry *e = map_find(c->entries, intern(key));
+    if( e && e->refs > 0 ) e->refs--;
+    if( e && !e->refs ) cache__evict(c, 0); // catch up with evictions skipped while pinned
+    cache__unlock(c);
+}
+void* cache_insert(const char *key, void *value, int size) {
+    return cache__put(key, value, size, 0);
+}
+void cache_budget(int64_t bytes) {
+    vfs__once(&cache_ready, cache__init);
+    cache_limit = bytes;
+    for( int i = 0; i < CACHE_SHARDS; ++i ) {
+        cache_shard *c = cache__lock(i);
+        cache__evict(c, 0);
+        cache__unlock(c);
+    }
+}
+int64_t cache_bytes() {
+    int64_t used = 0;
+    for( int i = 0; i < CACHE_SHARDS; ++i ) used += cache_shards[i].used; // approximate while others insert
+    return used;
+}
+void cache_stats(int64_t *hits, int64_t *misses, int64_t *evictions) {
+    int64_t h = 0, m = 0, e = 0;
+    for( int i = 0; i < CACHE_SHARDS; ++i ) {
+        cache_shard *c = cache__lock(i);
+        h += c->hits, m += c->misses, e += c->evictions;
+        c->hits = c->misses = c->evictions = 0;
+        cache__unlock(c);
+    }
+    if( hits ) *hits = h;
+    if( misses ) *misses = m;
+    if( evictions ) *evictions = e;
+}
+
+// -----------------------------------------------------------------------------
+// async loads
+
+enum { ASYNC_QUEUED, ASYNC_RUNNING, ASYNC_DONE };
+
+typedef struct vfs_job {
+    vfs_request req;
+    void* (*decode)(vfs_request *r);
+    void  (*finalize)(vfs_request *r);
+    int state;
+    struct vfs_job *next;
+} vfs_job;
+
+static thread_mutex_t async_mutex;
+static thread_signal_t async_signal;
+static vfs_job *async_queued[3], *async_done[3]; // one fifo per priority class
+static map(int, vfs_job*) async_jobs; // id -> job. pending requests only
+static int async_ids;
+
+static void async_push(vfs_job **list, vfs_job *job) { // append. lock must be held
+    job->next = 0;
+    while( *list ) list = &(*list)->next;
+    *list = job;
+}
+static vfs_job *async_pop(vfs_job **lists) { // highest priority first. lock must be held
+    for( int i = 0; i < 3; ++i ) {
+        vfs_job *job = lists[i];
+        if( job ) return lists[i] = job->next, job;
+    }
+    return 0;
+}
+
+static int vfs_async_worker(void *arg) {
+    for(;;) {
+        thread_signal_wait(&async_signal, 100);
+
+        for(;;) {
+            thread_mutex_lock(&async_mutex);
+            vfs_job *job = async_pop(async_queued);
+            if( job ) job->state = ASYNC_RUNNING;
+            thread_mutex_unlock(&async_mutex);
+            if( !job ) break;
+
+            // pinned while copied, so other loads cannot evict it from under us. no vfs_lock(): extraction runs in parallel
+            int size = 0;
+            char *data = job->req.cancelled ? 0 : vfs_acquire(job->req.pathfile, &size);
+            if( data ) {
+                job->req.data = memcpy(REALLOC(0, size+1), data, size);
+                job->req.data[ job->req.size = size ] = 0;
+                vfs_release(job->req.pathfile);
+            }
+
+            if( job->decode && !job->req.cancelled ) job->req.decoded = job->decode(&job->req);
+            stringf_reset();
+
+            thread_mutex_lock(&async_mutex);
+            job->state = ASYNC_DONE;
+            async_push(&async_done[job->req.priority], job);
+            thread_mutex_unlock(&async_mutex);
+        }
+    }
+    return 0;
+}
+
+static thread_atomic_int_t async_ready;
+static void async__init() {
+    thread_mutex_init(&async_mutex);
+    thread_signal_init(&async_signal);
+    map_init(async_jobs, less_int, hash_int);
+    for( int i = 0; i < ASYNC_WORKERS; ++i ) {
+        thread_create( vfs_async_worker, NULL, "vfs_async_worker()", 0 );
+    }
+}
+
+int vfs_load_async(const char *pathfile, int priority, void* (*decode)(vfs_request *r), void (*finalize)(vfs_request *r), void *userdata) {
+    vfs__once(&async_ready, async__init);
+
+    vfs_job *job = REALLOC(0, sizeof(vfs_job)), zero = {0};
+    *job = zero;
+    job->req.pathfile = intern_str(intern(pathfile));
+    job->req.userdata = userdata;
+    job->req.priority = priority < ASYNC_HIGH ? ASYNC_HIGH : priority > ASYNC_LOW ? ASYNC_LOW : priority;
+    job->decode = decode;
+    job->finalize = finalize;
+
+    thread_mutex_lock(&async_mutex);
+    job->req.id = ++async_ids;
+    map_insert(async_jobs, job->req.id, job);
+    async_push(&async_queued[job->req.priority], job);
+    thread_mutex_unlock(&async_mutex);
+
+    thread_signal_raise(&async_signal);
+    return job->req.id;
+}
+
+int vfs_cancel(int id) {
+    if( thread_atomic_int_load(&async_ready) != 2 ) return 0;
+    thread_mutex_lock(&async_mutex);
+    vfs_job **found = map_find(async_jobs, id), *job = found ? *found : 0;
+    int pending = job && !job->req.cancelled;
+    if( pending ) {
+        job->req.cancelled = 1;
+        if( job->state == ASYNC_QUEUED ) { // skip the load: move it straight to finalization
+            vfs_job **list = &async_queued[job->req.priority];
+            while( *list != job ) list = &(*list)->next;
+            *list = job->next;
+            job->state = ASYNC_DONE;
+            async_push(&async_done[job->req.priority], job);
+        }
+    }
+    thread_mutex_unlock(&async_mutex);
+    return pending;
+}
+
+int vfs_pending() {
+    if( thread_atomic_int_load(&async_ready) != 2 ) return 0;
+    thread_mutex_lock(&async_mutex);
+    int count = map_count(async_jobs);
+    thread_mutex_unlock(&async_mutex);
+    return count;
+}
+
+void cache_frame() { // unpinned pointers of previous frame are not in use anymore
+    vfs__retire(); // and neither are vfs_map() views into remounted archives
+    if( thread_atomic_int_load(&cache_ready) != 2 ) return;
+    for( int i = 0; i < CACHE_SHARDS; ++i ) {
+        cache_shard *c = cache__lock(i);
+        for( int j = 0; j < array_count(c->retired); ++j ) REALLOC(c->retired[j], 0);
+        array_clear(c->retired);
+        cache__unlock(c);
+    }
+    thread_atomic_int_inc(&cache_epoch);
+    for( int i = 0; i < CACHE_SHARDS; ++i ) {
+        cache_shard *c = cache__lock(i);
+        cache__evict(c, 0); // catch up with evictions skipped meanwhile
+        cache__unlock(c);
+    }
+}
+
+void vfs_async_update(double budget_ms) {
+    cache_frame();
+    if( thread_atomic_int_load(&async_ready) != 2 ) return;
+    double start = time_ms();
+    do {
+        thread_mutex_lock(&async_mutex);
+        vfs_job *job = async_pop(async_done);
+        if( job ) map_erase(async_jobs, job->req.id);
+        thread_mutex_unlock(&async_mutex);
+        if( !job ) break;
+
+        if( job->finalize ) job->finalize(&job->req);
+        REALLOC(job->req.data, 0);
+        REALLOC(job, 0);
+    } while( (time_ms() - start) < budget_ms );
+}
+
+// demo -----------------------------------------------------------------------
+
+#ifdef FILE_DEMO
+// batched reads benchmark: 10k small files, file_load() one by one vs file_read_batch() (io_uring, then threads).
+// page cache is dropped per file before each run (posix_fadvise), so reads are cold-ish when the files were flushed to disk.
+
+enum { BENCH_FILES = 10000 };
+
+static double bench_clock() { // wall clock. time_ss() requires a window
+#ifdef _WIN32
+    LARGE_INTEGER f, c; QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / f.QuadPart;
 #else
-    int sz;
-    char *buf = vfs_load(pathfile, &sz);
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+static void bench_drop(file_range *ranges) {
+#ifdef __linux__
+    for( int i = 0; i < BENCH_FILES; ++i ) {
+        int fd = open(ranges[i].pathfile, O_RDONLY);
+        if( fd >= 0 ) fdatasync(fd), posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), close(fd);
+    }
+#endif
+}
+static void bench_check(file_range *ranges, char **expected, int *sizes, const char *title, double time) {
+    for( int i = 0; i < BENCH_FILES; ++i ) {
+        assert( ranges[i].data && ranges[i].size == sizes[i] && !memcmp(ranges[i].data, expected[i], sizes[i]) );
+        REALLOC(ranges[i].data, 0), ranges[i].data = 0;
+    }
+    printf("%-28s %.3fs\n", title, time);
+}
+int main() {
+    static file_range ranges[BENCH_FILES];
+    static char *expected[BENCH_FILES];
+    static int sizes[BENCH_FILES];
 
-#if 1 // def _WIN32
-    char *name = tmpnam(0);
-#else    
-    // Create the temporary file, this function will replace the 'X's
-    char name[32] = "/tmp/fwk-XXXXXX";
-    mkstemp(name);
-    // Queue unlink so that the file is deleted once closed or during program exit
-    unlink(name);
+    // 10k files, 1..8 KiB each
+#ifdef _WIN32
+    mkdir("bench_io");
+#else
+    mkdir("bench_io", 0777);
 #endif
+    for( int i = 0; i < BENCH_FILES; ++i ) {
+        ranges[i].pathfile = STRDUP(stringf("bench_io/%05d.bin", i));
+        ranges[i].len = -1;
+        sizes[i] = 1024 + (i * 2654435761u) % (7 * 1024);
+        expected[i] = REALLOC(0, sizes[i]);
+        for( int j = 0; j < sizes[i]; ++j ) expected[i][j] = (char)(i + j);
+        for( FILE *fp = fopen(ranges[i].pathfile, "wb"); fp; fclose(fp), fp = 0 ) fwrite(expected[i], 1, sizes[i], fp);
+    }
+
+    double time;
+    bench_drop(ranges), time = -bench_clock();
+    for( int i = 0; i < BENCH_FILES; ++i ) ranges[i].data = file_load(ranges[i].pathfile, &ranges[i].size);
+    bench_check(ranges, expected, sizes, "file_load() loop", time + bench_clock());
 
-    FILE *tmp = fopen(name, "wb");
-    ASSERT( tmp, "cannot create tempfile %s", name );
-    fwrite(buf ? buf : "", 1, buf ? sz : 0, tmp);
-    fclose(tmp);
-    return name;
+#if defined(__linux__) && FILE_BATCH_URING
+    bench_drop(ranges), time = -bench_clock();
+    int uring = file__batch_uring(ranges, BENCH_FILES);
+    time += bench_clock();
+    if( uring < 0 ) puts("file_read_batch() io_uring: not available");
+    else bench_check(ranges, expected, sizes, "file_read_batch() io_uring", time);
 #endif
+
+    bench_drop(ranges), time = -bench_clock();
+    file__batch_threads(ranges, BENCH_FILES);
+    bench_check(ranges, expected, sizes, "file_read_batch() threads", time + bench_clock());
+
+    // ranges: middle of files
+    for( int i = 0; i < BENCH_FILES; ++i ) ranges[i].offset = 100, ranges[i].len = 200;
+    assert( file_read_batch(ranges, BENCH_FILES) == BENCH_FILES );
+    for( int i = 0; i < BENCH_FILES; ++i ) {
+        assert( ranges[i].size == 200 && !memcmp(ranges[i].data, expected[i] + 100, 200) && !ranges[i].data[200] );
+        REALLOC(ranges[i].data, 0);
+        unlink(ranges[i].pathfile);
+        FREE((void*)ranges[i].pathfile), REALLOC(expected[i], 0);
+    }
+    rmdir("bench_io");
+    puts("ok");
 }
+#define main main__
+#endif // FILE_DEMO
 
+#ifdef VFS_DEMO
+// concurrent readers stress test: threads load random entries from a zip (stored and deflated) and a pak,
+// thru vfs_acquire(), vfs_fopen() streams and vfs_map() views, while a tiny cache budget keeps evicting.
+// every read is checked against the crc32 of its generated contents.
 
-// -----------------------------------------------------------------------------
-// cache
+enum { STRESS_FILES = 600, STRESS_THREADS = 8, STRESS_LOADS = 20000 };
+static uint32_t stress_crc[STRESS_FILES];
+static thread_atomic_int_t stress_errors;
 
-void* cache_lookup(const char *pathfile, int *size) { // find key->value
-    if( !MAX_CACHED_FILES ) return 0;
-    for(archive_dir *dir = dir_cache; dir; dir = dir->next) {
-        if( !strcmp(dir->path, pathfile) ) {
-            if(size) *size = dir->size;
-            return dir->data;
+static const char *stress_name(int i) { // first half goes to zip (even entries stored, odd ones deflated), second half to pak
+    return stringf("stress/%s%03d.txt", i < STRESS_FILES / 2 ? "zip" : "pak", i);
+}
+static char *stress_data(int i, int *len) { // compressible text, 1..64 KiB
+    *len = 1 + (i * 2654435761u) % (64 * 1024);
+    char *data = REALLOC(0, *len);
+    for( int j = 0; j < *len; ++j ) data[j] = "abcdefgh \n"[(i + j / 7) % 10];
+    return data;
+}
+static int stress_thread( void *arg ) {
+    uint64_t seed = (uintptr_t)arg * 0x9E3779B97F4A7C15ull + 1;
+    for( int n = 0; n < STRESS_LOADS; ++n ) {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17; // xorshift64
+        int i = (seed >> 32) % STRESS_FILES, size = 0, how = (seed >> 16) % 3;
+        const char *name = stress_name(i);
+        uint32_t crc = ~stress_crc[i];
+#ifdef ZIP_NO_MMAP
+        how = how == 2 ? 0 : how; // vfs_map() would fall back to unpinned vfs_load() views
+#endif
+        if( how == 2 && i < STRESS_FILES / 2 && !(i & 1) ) { // zero-copy view. mapped archives are never evicted
+            const char *view = vfs_map(name, &size);
+            if( view ) crc = zip__crc32(0, view, size);
         }
+        else if( how == 1 ) { // stream, in small chunks
+            vfs_file *fp = vfs_fopen(name);
+            char buf[4096];
+            if( fp ) crc = 0;
+            for( int rd; fp && (rd = vfs_fread(fp, buf, sizeof(buf))) > 0; ) crc = zip__crc32(crc, buf, rd);
+            if( fp ) vfs_fclose(fp);
+        }
+        else { // cached, and pinned while checked
+            char *data = vfs_acquire(name, &size);
+            if( data ) crc = zip__crc32(0, data, size), vfs_release(name);
+        }
+        if( crc != stress_crc[i] ) thread_atomic_int_inc(&stress_errors);
+        stringf_reset();
     }
     return 0;
 }
-void* cache_insert(const char *pathfile, void *ptr, int size) { // append key/value; return LRU or NULL
-    if( !MAX_CACHED_FILES ) return 0;
-    assert( ptr );
-    assert( size );
-
-    // append to cache
-    archive_dir zero = {0}, *old = dir_cache;
-    *(dir_cache = REALLOC(0, sizeof(archive_dir))) = zero;
-    dir_cache->next = old;
-    dir_cache->path = STRDUP(pathfile);
-    dir_cache->size = size;
-    dir_cache->data = REALLOC(0, size+1);
-    memcpy(dir_cache->data, ptr, size); size[(char*)dir_cache->data] = 0; // copy+terminator
-
-    // keep cached files within limits
-    static int added = 0;
-    if( added < MAX_CACHED_FILES ) {
-        ++added;
-    } else {
-        // remove oldest cache entry
-        for( archive_dir *prev = dir_cache, *dir = prev; dir ; prev = dir, dir = dir->next ) {
-            if( !dir->next ) {
-                prev->next = 0; // break link
-                void *data = dir->data;
-                dir->path = REALLOC(dir->path, 0);
-                dir->data = REALLOC(dir->data, 0);
-                dir = REALLOC(dir, 0);
-                return data;
-            }
+int main() {
+#ifdef _WIN32
+    mkdir("stress");
+#else
+    mkdir("stress", 0777);
+#endif
+    zip *z = zip_open("stress.zip", "wb");
+    pak *p = pak_open("stress.pak", "wb");
+    for( int i = 0; i < STRESS_FILES; ++i ) {
+        int len; char *data = stress_data(i, &len);
+        stress_crc[i] = zip__crc32(0, data, len); // also warms up crc table, before threads race for it
+        if( i < STRESS_FILES / 2 ) {
+            for( FILE *fp = fopen(stress_name(i), "wb"); fp; fclose(fp), fp = 0 ) fwrite(data, 1, len, fp);
+            for( FILE *fp = fopen(stress_name(i), "rb"); fp; fclose(fp), fp = 0 ) zip_append_file(z, stress_name(i), 0, fp, i & 1 ? 6 : 0);
+            unlink(stress_name(i));
+        } else {
+            pak_append_data(p, stress_name(i), data, len);
         }
+        REALLOC(data, 0);
     }
-    return 0;
+    zip_close(z), pak_close(p);
+    rmdir("stress");
+
+    assert( vfs_mount("stress.zip") && vfs_mount("stress.pak") );
+    cache_budget(256 * 1024); // a handful of entries per shard
+
+    thread_ptr_t t[STRESS_THREADS];
+    for( int i = 0; i < STRESS_THREADS; ++i ) t[i] = thread_create(stress_thread, (void*)(uintptr_t)(i + 1), 0, 0);
+    for( int i = 0; i < STRESS_THREADS; ++i ) thread_join(t[i]), thread_destroy(t[i]);
+
+    int64_t hits, misses, evictions;
+    cache_stats(&hits, &misses, &evictions);
+    printf("%d threads x %d loads: %d errors. cache: %lld hits, %lld misses, %lld evictions\n", STRESS_THREADS, STRESS_LOADS,
+        thread_atomic_int_load(&stress_errors), (long long)hits, (long long)misses, (long long)evictions);
+    assert( thread_atomic_int_load(&stress_errors) == 0 );
+    unlink("stress.zip"), unlink("stress.pak");
+    puts("ok");
+}
+#define main main__
+#endif // VFS_DEMO
+
+#ifdef FILE_CACHE_DEMO
+// decoded cache: cold image_from_mem() inflates png files and saves their texels; warm calls map them back instead.
+
+enum { DECODE_IMAGES = 16, DECODE_SIZE = 1024 };
+
+static double decode_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+int main() {
+    static unsigned char *png[DECODE_IMAGES]; static int pnglen[DECODE_IMAGES];
+    static image_t cold[DECODE_IMAGES];
+
+    unsigned char *rgba = REALLOC(0, DECODE_SIZE * DECODE_SIZE * 4);
+    for( int i = 0; i < DECODE_IMAGES; ++i ) { // gradients plus noise, so png filters and deflate have some work to do
+        for( int j = 0; j < DECODE_SIZE * DECODE_SIZE * 4; ++j ) rgba[j] = (j / 4 % DECODE_SIZE + j / 4 / DECODE_SIZE * i) ^ ((j * 2654435761u) >> 29);
+        png[i] = stbi_write_png_to_mem(rgba, 0, DECODE_SIZE, DECODE_SIZE, 4, &pnglen[i]);
+    }
+    REALLOC(rgba, 0);
+
+    // disk-cached blobs do not count as cold
+    for( int i = 0; i < DECODE_IMAGES; ++i ) {
+        uint64_t key = file_cache_key(png[i], pnglen[i], stringf("image %#x", IMAGE_RGBA));
+        remove(stringf("%s%016llx", FILE_CACHE_DIR, (unsigned long long)key));
+    }
+
+    double t0 = decode_clock();
+    for( int i = 0; i < DECODE_IMAGES; ++i ) cold[i] = image_from_mem(png[i], pnglen[i], IMAGE_RGBA);
+    double t1 = decode_clock();
+    for( int i = 0; i < DECODE_IMAGES; ++i ) {
+        image_t warm = image_from_mem(png[i], pnglen[i], IMAGE_RGBA);
+        assert( warm.pixels && warm.w == cold[i].w && warm.h == cold[i].h && warm.n == cold[i].n );
+        assert( !memcmp(warm.pixels, cold[i].pixels, warm.w * warm.h * warm.n) );
+        image_destroy(&warm);
+    }
+    double t2 = decode_clock();
+
+    // a flag changing the output is a different entry
+    image_t flipped = image_from_mem(png[0], pnglen[0], IMAGE_RGBA|IMAGE_FLIP);
+    assert( !memcmp(flipped.pixels, cold[0].pixels8 + (DECODE_SIZE - 1) * DECODE_SIZE * 4, DECODE_SIZE * 4) );
+    image_destroy(&flipped);
+
+    printf("%d images %dx%d: cold %.3fs, warm %.3fs\n", DECODE_IMAGES, DECODE_SIZE, DECODE_SIZE, t1 - t0, t2 - t1);
+    for( int i = 0; i < DECODE_IMAGES; ++i ) image_destroy(&cold[i]), free(png[i]);
+    puts("ok");
 }
+#define main main__
+#endif // FILE_CACHE_DEMO
 
 #endif // FILE_C
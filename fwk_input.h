@@ -276,8 +276,8 @@ static struct controller_t *input_logger(int position, int advance) {
 }
 
 void input_mappings() {
-    unsigned char* mappings = file_read(file_find("gamecontrollerdb.txt"));
-    if( mappings ) { glfwUpdateGamepadMappings(mappings); REALLOC(mappings, 0); }
+    char* mappings = vfs_read("gamecontrollerdb.txt");
+    if( mappings ) { glfwUpdateGamepadMappings(mappings); }
 }
 
 void input_init() {
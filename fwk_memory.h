@@ -12,17 +12,19 @@
 
 // memory api
 #define MSIZE(p)      xsize(p)
-#define REALLOC(p,sz) (rllcsz_ = (sz), (rllcsz_ ? WATCH(xrealloc((p),rllcsz_),rllcsz_) : xrealloc(FORGET(p),0)))
+#define REALLOC(p,sz) (rllcsz_ = (sz), (rllcsz_ ? WATCH(xrealloc(FORGET(p),rllcsz_),rllcsz_) : xrealloc(FORGET(p),0)))
 #define MALLOC(sz)    REALLOC(0,(sz))
 #define FREE(p)       REALLOC(FORGET(p), 0)
 #define CALLOC(n,sz)  (rllcsz_ = (n)*(sz), memset(REALLOC(0,rllcsz_),0,rllcsz_))
 #define STRDUP(s)     (strdsz_ = strlen(s)+1, ((char*)memcpy(REALLOC(0,strdsz_), (s), strdsz_)))
 static threadlocal size_t rllcsz_, strdsz_;
 
-// memory leaks detector
-#if WITH_LEAK_DETECTOR
-#define WATCH(ptr,sz) watch((ptr), (sz))
+// memory leaks detector & allocation profiler
+#if WITH_LEAK_DETECTOR || WITH_ALLOC_PROFILER
+#define WATCH(ptr,sz) watch_at((ptr), (sz), __FILE__ ":" WATCH_STRINGIZE(__LINE__))
 #define FORGET(ptr)   forget(ptr)
+#define WATCH_STRINGIZE(x) WATCH_STRINGIZ3(x)
+#define WATCH_STRINGIZ3(x) #x
 #else
 #define WATCH(ptr,sz) (ptr)
 #define FORGET(ptr)   (ptr)
@@ -32,12 +34,33 @@ static threadlocal size_t rllcsz_, strdsz_;
 void*  xrealloc(void* p, size_t sz);
 size_t xsize(void* p);
 
-// stack based allocator (negative bytes does rewind stack, like when entering new frame)
-void*  stack(int bytes);
+// thread-caching size-class allocator. to enable it: -DSYS_REALLOC=trealloc -DSYS_MSIZE=tsize
+void*  trealloc(void* p, size_t sz);
+size_t tsize(void* p);
+
+// stack based allocator (growable chain of blocks; automatically rewound at window_swap())
+void*    stack(int bytes); // negative bytes does rewind stack, like when entering new frame
+uint64_t stack_push(); // returns a marker to current stack position
+void     stack_pop(uint64_t marker); // rewinds stack back to marker
+uint64_t stack_peak(); // high-water mark, in bytes
+
+// object pool allocator (fixed-size objects; free-lists, slab growth and per-thread caches if threadsafe)
+typedef struct pool_t pool_t;
+pool_t* pool_create(int objsize, int objs_per_slab, int threadsafe);
+void*   pool_alloc(pool_t *p);
+void    pool_free(pool_t *p, void *ptr);
+int     pool_count(pool_t *p); // live objects
+void    pool_destroy(pool_t *p); // releases all slabs at once
 
-// memory leaks
+// memory leaks (in-memory table of live allocations, grouped by callstack)
 void*  watch( void *ptr, int sz );
+void*  watch_at( void *ptr, int sz, const char *fileline );
 void*  forget( void *ptr );
+void   watch_report( FILE *fp ); // dump live allocations by callsite. also invoked at exit.
+
+// allocation profiler (WITH_ALLOC_PROFILER=1): counts, bytes, live bytes and size histogram per __FILE__:__LINE__
+void   watch_frame(); // close current frame stats and feed profiler. invoked at window_swap().
+bool   watch_csv( const char *filename ); // export per-callsite stats
 
 #endif
 
@@ -70,6 +93,205 @@ void*  forget( void *ptr );
 #endif
 #endif
 
+// trealloc --------------------------------------------------------------------
+// small blocks (<= 32 KiB) are served from per-thread free-lists, 40 size classes (16-byte steps up
+// to 128 bytes, then 4 classes per power of two). blocks freed by other threads are pushed into
+// owner's lock-free remote queue, which owner drains when its own free-list runs dry.
+// heaps of exiting threads are parked in an orphan list, and adopted by the next thread that needs one.
+// large blocks go straight to system realloc(). every block has a 16-byte header in front.
+
+#define TBLOCK_CLASSES  40
+#define TBLOCK_LARGE    0xFFFFu
+#define TBLOCK_MAGIC    0x7B10C4u
+#ifndef TBLOCK_SPANSIZE
+#define TBLOCK_SPANSIZE (64 * 1024) // bytes requested from system every time a size class runs dry
+#endif
+
+typedef struct tblock {
+    union {
+        struct theap *heap; // owner (allocated small blocks)
+        struct tblock *next; // free-lists
+        size_t size; // large blocks
+    };
+    uint32_t cls, magic;
+} tblock;
+
+typedef struct theap {
+    tblock *free[TBLOCK_CLASSES];
+    tblock *volatile remote; // lock-free stack of blocks released by other threads
+    struct theap *next; // orphan list
+    int64_t spans; // stats
+} theap;
+
+typedef int tblock_header_is_16_bytes[ sizeof(tblock) == 16 ];
+
+static threadlocal theap *theap_local;
+static theap *volatile theap_orphans; // heaps of dead threads, waiting for adoption
+
+#ifdef _MSC_VER
+#define tblock_cas(dst,cmp,xchg) _InterlockedCompareExchangePointer((void*volatile*)(dst), (xchg), (cmp))
+#define tblock_xchg(dst,xchg)    _InterlockedExchangePointer((void*volatile*)(dst), (xchg))
+#else
+#define tblock_cas(dst,cmp,xchg) __sync_val_compare_and_swap((dst), (cmp), (xchg))
+#define tblock_xchg(dst,xchg)    __sync_lock_test_and_set((dst), (xchg))
+#endif
+
+static unsigned tblock_class( size_t sz ) {
+    if( sz <= 128 ) return sz ? (unsigned)(sz - 1) / 16 : 0;
+    unsigned b = 7; while( ((size_t)2 << b) < sz ) ++b; // sz in (2^b, 2^(b+1)]
+    size_t step = (size_t)1 << (b - 2);
+    return 8 + (b - 7) * 4 + (unsigned)((sz - ((size_t)1 << b) + step - 1) / step) - 1;
+}
+static size_t tblock_class_size( unsigned cls ) {
+    if( cls < 8 ) return (cls + 1) * 16;
+    unsigned b = 7 + (cls - 8) / 4, sub = 1 + (cls - 8) % 4;
+    return ((size_t)1 << b) + sub * ((size_t)1 << (b - 2));
+}
+
+static void theap_orphan( void *ptr ) { // thread-exit hook. blocks still alive keep pointing to this heap, so it is never released
+    theap *h = (theap*)ptr;
+    theap_local = 0; // later allocations from other exit hooks of this thread will pick another heap
+    for( theap *head;; ) {
+        head = theap_orphans;
+        h->next = head;
+        if( tblock_cas(&theap_orphans, head, h) == head ) break;
+    }
+}
+static theap *theap_adopt() { // pops are serialized by a spin flag, so a popped heap cannot be re-pushed under our feet (aba)
+    static void *volatile busy;
+    if( !theap_orphans ) return 0;
+    while( tblock_cas(&busy, (void*)0, (void*)1) ) {}
+    theap *h;
+    for( ;; ) {
+        h = theap_orphans;
+        if( !h || tblock_cas(&theap_orphans, h, h->next) == h ) break;
+    }
+    tblock_xchg(&busy, (void*)0);
+    return h;
+}
+#ifdef _WIN32
+static DWORD theap_key = FLS_OUT_OF_INDEXES;
+static VOID WINAPI theap_exit( PVOID ptr ) { if( ptr ) theap_orphan(ptr); }
+static BOOL CALLBACK theap_key_init( PINIT_ONCE once, PVOID arg, PVOID *ctx ) { theap_key = FlsAlloc(theap_exit); return TRUE; }
+static void theap_track( theap *h ) {
+    static INIT_ONCE once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&once, theap_key_init, 0, 0);
+    if( theap_key != FLS_OUT_OF_INDEXES ) FlsSetValue(theap_key, h);
+}
+#else
+static pthread_key_t theap_key;
+static void theap_key_init() { pthread_key_create(&theap_key, theap_orphan); }
+static void theap_track( theap *h ) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, theap_key_init);
+    pthread_setspecific(theap_key, h);
+}
+#endif
+static theap *theap_get() {
+    if( !theap_local ) {
+        theap *h = theap_adopt();
+        if( !h ) {
+            h = (theap*)realloc(0, sizeof(theap));
+            if( !h ) return 0;
+            memset(h, 0, sizeof(theap));
+        }
+        theap_track(theap_local = h);
+    }
+    return theap_local;
+}
+static void theap_drain( theap *h ) {
+    for( tblock *next, *b = (tblock*)tblock_xchg(&h->remote, (tblock*)0); b; b = next ) {
+        next = b->next;
+        b->next = h->free[b->cls];
+        h->free[b->cls] = b;
+    }
+}
+static bool theap_refill( theap *h, unsigned cls ) {
+    size_t stride = sizeof(tblock) + tblock_class_size(cls);
+    size_t count = TBLOCK_SPANSIZE / stride; if( count < 8 ) count = 8;
+    char *span = (char*)realloc(0, count * stride); // spans are never returned to system
+    if( !span ) return false;
+    for( size_t i = count; i-- > 0; ) {
+        tblock *b = (tblock*)(span + i * stride);
+        b->cls = cls, b->magic = TBLOCK_MAGIC;
+        b->next = h->free[cls];
+        h->free[cls] = b;
+    }
+    h->spans++;
+    return true;
+}
+
+static void *tmalloc_( size_t sz ) {
+    if( sz > 32 * 1024 ) {
+        tblock *b = (tblock*)realloc(0, sizeof(tblock) + sz);
+        if( !b ) return 0;
+        b->size = sz, b->cls = TBLOCK_LARGE, b->magic = TBLOCK_MAGIC;
+        return b + 1;
+    }
+    theap *h = theap_get();
+    if( !h ) return 0;
+    unsigned cls = tblock_class(sz);
+    if( !h->free[cls] && h->remote ) theap_drain(h);
+    if( !h->free[cls] && !theap_refill(h, cls) ) return 0;
+    tblock *b = h->free[cls];
+    h->free[cls] = b->next;
+    b->heap = h;
+    return b + 1;
+}
+static void tfree_( void *ptr ) {
+    tblock *b = (tblock*)ptr - 1;
+    if( b->magic != TBLOCK_MAGIC ) PANIC("trealloc(): freeing unknown pointer %p", ptr);
+    if( b->cls == TBLOCK_LARGE ) {
+        b->magic = 0;
+        realloc(b, 0);
+        return;
+    }
+    theap *owner = b->heap, *h = theap_local;
+    if( owner == h ) {
+        b->next = h->free[b->cls];
+        h->free[b->cls] = b;
+        return;
+    }
+    // cross-thread release: push into owner's remote stack
+    for( tblock *head;; ) {
+        head = owner->remote;
+        b->next = head;
+        if( tblock_cas(&owner->remote, head, b) == head ) break;
+    }
+}
+
+size_t tsize( void *ptr ) {
+    if( !ptr ) return 0;
+    tblock *b = (tblock*)ptr - 1;
+    return b->cls == TBLOCK_LARGE ? b->size : tblock_class_size(b->cls);
+}
+void* trealloc( void *ptr, size_t sz ) {
+    if( !sz ) {
+        if( ptr ) tfree_(ptr);
+        return 0;
+    }
+    if( !ptr ) {
+        return tmalloc_(sz);
+    }
+    tblock *b = (tblock*)ptr - 1;
+    if( b->magic != TBLOCK_MAGIC ) PANIC("trealloc(): resizing unknown pointer %p", ptr);
+    if( b->cls == TBLOCK_LARGE && sz > 32 * 1024 ) {
+        b = (tblock*)realloc(b, sizeof(tblock) + sz);
+        if( !b ) return 0;
+        b->size = sz;
+        return b + 1;
+    }
+    size_t oldsz = tsize(ptr);
+    if( b->cls != TBLOCK_LARGE && sz <= 32 * 1024 && tblock_class(sz) == b->cls ) {
+        return ptr; // still fits in same size class
+    }
+    void *newptr = tmalloc_(sz);
+    if( !newptr ) return 0;
+    memcpy(newptr, ptr, oldsz < sz ? oldsz : sz);
+    tfree_(ptr);
+    return newptr;
+}
+
 // xrealloc --------------------------------------------------------------------
 
 void* xrealloc(void* oldptr, size_t size) {
@@ -91,41 +313,612 @@ size_t xsize(void* p) {
 
 // stack -----------------------------------------------------------------------
 
+#ifndef STACK_BLOCKSIZE
+#define STACK_BLOCKSIZE (4 * 1024 * 1024) // 4 MiB per block. blocks are chained when exhausted.
+#endif
+
+typedef struct stack_block {
+    struct stack_block *prev, *next;
+    uint64_t base, used, cap; // base: stack offset of first byte in this block
+    uint64_t below; // bytes in use by previous blocks. unlike base, skipped tails of those blocks are not counted
+} stack_block;
+
+static threadlocal stack_block *stack_top = 0; // current block. next blocks are kept for reuse
+static threadlocal uint64_t stack_max = 0; // bytes in use, at most. watch this var, in case you want to fine tune STACK_BLOCKSIZE above
+
 void* stack(int bytes) { // use negative bytes to rewind stack
-    static threadlocal uint8_t *stack_mem = 0;
-    static threadlocal uint64_t stack_ptr = 0;
-    static threadlocal uint64_t stack_max = 0; // watch this var, in case you want to fine tune 4 MiB value below
     if( bytes < 0 ) {
-        if( stack_ptr > stack_max ) stack_max = stack_ptr;
-        return (stack_ptr = 0), NULL;
+        stack_pop(0);
+        return NULL;
+    }
+    bytes = (bytes + 15) & ~15; // 16-byte aligned
+
+    stack_block *b = stack_top;
+    if( !b || (b->used + bytes) > b->cap ) {
+        // move to next cached block, or chain a new one if not big enough
+        stack_block *next = b ? b->next : 0;
+        if( next && next->cap < bytes ) {
+            for( stack_block *n; next; next = n ) n = next->next, xrealloc(next, 0);
+            b->next = 0;
+        }
+        if( !next ) {
+            uint64_t cap = bytes > STACK_BLOCKSIZE ? bytes : STACK_BLOCKSIZE;
+            next = (stack_block*)xrealloc(0, sizeof(stack_block) + cap);
+            next->prev = b, next->next = 0, next->cap = cap;
+            if( b ) b->next = next;
+        }
+        next->base = b ? b->base + b->cap : 0;
+        next->below = b ? b->below + b->used : 0;
+        next->used = 0;
+        stack_top = b = next;
+    }
+
+    uint8_t *ptr = (uint8_t*)(b + 1) + b->used;
+    b->used += bytes;
+    if( (b->below + b->used) > stack_max ) stack_max = b->below + b->used;
+    return ptr;
+}
+uint64_t stack_push() {
+    return stack_top ? stack_top->base + stack_top->used : 0;
+}
+void stack_pop(uint64_t marker) {
+    stack_block *b = stack_top;
+    while( b && b->prev && b->base > marker ) b = b->prev;
+    if( b ) b->used = marker > b->base ? marker - b->base : 0;
+    stack_top = b;
+}
+uint64_t stack_peak() {
+    return stack_max;
+}
+
+// pool ------------------------------------------------------------------------
+
+#ifndef POOL_THREADCACHES
+#define POOL_THREADCACHES 16 // per-thread free-lists (threadsafe pools only). threads are hashed into these.
+#endif
+#ifndef POOL_THREADCACHE_MAX
+#define POOL_THREADCACHE_MAX 64 // objects kept in every per-thread free-list before spilling into global one
+#endif
+
+typedef struct pool_node {
+    struct pool_node *next;
+} pool_node;
+
+typedef struct pool_cache {
+    thread_mutex_t lock; // almost never contended, unless there are more threads than POOL_THREADCACHES
+    pool_node *free;
+    int count;
+} pool_cache;
+
+struct pool_t {
+    int objsize, slabcount, threadsafe, live;
+    void *slabs; // chain of slabs. first word of every slab links to the previous one
+    pool_node *free; // global free-list
+    thread_mutex_t lock;
+    pool_cache caches[POOL_THREADCACHES];
+};
+
+// one-time inits, safe when several threads race for them. state: 0 uninit, 1 initializing, 2 ready
+static void memory_once(thread_atomic_int_t *state, void (*init)(void)) {
+    if( thread_atomic_int_load(state) == 2 ) return;
+    if( thread_atomic_int_compare_and_swap(state, 0, 1) == 0 ) init(), thread_atomic_int_store(state, 2);
+    while( thread_atomic_int_load(state) != 2 ) thread_yield();
+}
+
+static threadlocal int pool_thread_id = -1;
+static thread_atomic_int_t pool_thread_count;
+
+static pool_cache *pool_thread_cache(pool_t *p) {
+    if( pool_thread_id < 0 ) {
+        pool_thread_id = thread_atomic_int_inc(&pool_thread_count) % POOL_THREADCACHES;
+    }
+    return &p->caches[pool_thread_id];
+}
+
+static void pool_grow(pool_t *p) { // p->lock must be held
+    enum { SLAB_HEADER = 16 }; // keeps objects 16-byte aligned
+    char *slab = (char*)xrealloc(0, SLAB_HEADER + p->objsize * p->slabcount);
+    *(void**)slab = p->slabs;
+    p->slabs = slab;
+    // thread objects into global free-list, so they're handed out in memory order
+    for( int i = p->slabcount; --i >= 0; ) {
+        pool_node *n = (pool_node*)(slab + SLAB_HEADER + i * p->objsize);
+        n->next = p->free;
+        p->free = n;
+    }
+    // next slab will be twice as big, up to 64K objects
+    if( p->slabcount < 65536 ) p->slabcount *= 2;
+}
+
+pool_t* pool_create(int objsize, int objs_per_slab, int threadsafe) {
+    pool_t *p = (pool_t*)xrealloc(0, sizeof(pool_t));
+    memset(p, 0, sizeof(pool_t));
+    p->objsize = ((objsize < (int)sizeof(pool_node) ? (int)sizeof(pool_node) : objsize) + 15) & ~15;
+    p->slabcount = objs_per_slab > 0 ? objs_per_slab : 64;
+    p->threadsafe = threadsafe;
+    if( threadsafe ) {
+        thread_mutex_init(&p->lock);
+        for( int i = 0; i < POOL_THREADCACHES; ++i ) thread_mutex_init(&p->caches[i].lock);
+    }
+    return p;
+}
+
+void* pool_alloc(pool_t *p) {
+    pool_node *n;
+    if( !p->threadsafe ) {
+        if( !p->free ) pool_grow(p);
+        n = p->free, p->free = n->next;
+        return ++p->live, (void*)n;
+    }
+
+    pool_cache *c = pool_thread_cache(p);
+    thread_mutex_lock(&c->lock);
+    if( !c->free ) {
+        // refill thread cache from global free-list in a single batch
+        thread_mutex_lock(&p->lock);
+        if( !p->free ) pool_grow(p);
+        for( int i = 0; i < POOL_THREADCACHE_MAX / 2 && p->free; ++i ) {
+            n = p->free, p->free = n->next;
+            n->next = c->free, c->free = n, ++c->count;
+        }
+        thread_mutex_unlock(&p->lock);
+    }
+    n = c->free, c->free = n->next, --c->count;
+    thread_mutex_unlock(&c->lock);
+
+    #ifdef _MSC_VER
+    _InterlockedIncrement((long*)&p->live);
+    #else
+    __sync_add_and_fetch(&p->live, 1);
+    #endif
+    return n;
+}
+
+void pool_free(pool_t *p, void *ptr) {
+    if( !ptr ) return;
+    pool_node *n = (pool_node*)ptr;
+    if( !p->threadsafe ) {
+        n->next = p->free, p->free = n;
+        --p->live;
+        return;
+    }
+
+    pool_cache *c = pool_thread_cache(p);
+    thread_mutex_lock(&c->lock);
+    n->next = c->free, c->free = n, ++c->count;
+    if( c->count > POOL_THREADCACHE_MAX ) {
+        // spill half of thread cache back into global free-list
+        thread_mutex_lock(&p->lock);
+        while( c->count > POOL_THREADCACHE_MAX / 2 ) {
+            n = c->free, c->free = n->next, --c->count;
+            n->next = p->free, p->free = n;
+        }
+        thread_mutex_unlock(&p->lock);
     }
-    if( !stack_mem ) stack_mem = xrealloc(stack_mem, xsize(stack_mem) + 4 * 1024 * 1024);
-    return &stack_mem[ (stack_ptr += bytes) - bytes ];
+    thread_mutex_unlock(&c->lock);
+
+    #ifdef _MSC_VER
+    _InterlockedDecrement((long*)&p->live);
+    #else
+    __sync_sub_and_fetch(&p->live, 1);
+    #endif
+}
+
+int pool_count(pool_t *p) {
+    return p ? p->live : 0;
+}
+
+void pool_destroy(pool_t *p) {
+    if( !p ) return;
+    for( void *next, *slab = p->slabs; slab; slab = next ) {
+        next = *(void**)slab;
+        xrealloc(slab, 0);
+    }
+    if( p->threadsafe ) {
+        thread_mutex_term(&p->lock);
+        for( int i = 0; i < POOL_THREADCACHES; ++i ) thread_mutex_term(&p->caches[i].lock);
+    }
+    xrealloc(p, 0);
 }
 
 // leaks ----------------------------------------------------------------------
 
-void* watch( void *ptr, int sz ) {
-    if( ptr ) {
-        char buf[256];
-        sprintf(buf, "%p.mem", ptr);
-        for( FILE *fp = fopen(buf, "a+"); fp; fclose(fp), fp = 0 ) {
-            fseek(fp, 0L, SEEK_END);
-            char *callstack(int);
-            const char *cs = callstack( +48 ); // NULL; // =
-            fprintf(fp, "Built %s %s\n", __DATE__, __TIME__); // today() instead?
-            fprintf(fp, "Memleak address: [%p], size: %d\n%s\n", ptr, sz, cs ? cs : "No callstack.");
+#ifndef WATCH_FRAMES
+#define WATCH_FRAMES 16 // callstack depth recorded per allocation site
+#endif
+
+typedef struct watch_site {
+    uint64_t id; // hash of callstack frames
+    void *frames[WATCH_FRAMES];
+    int num_frames;
+    int64_t count, bytes; // live allocations
+} watch_site;
+
+typedef struct watch_tag {
+    const char *fileline; // callsite. string literal
+    const char *label; // profiler key
+    int64_t allocs, frees, bytes; // totals
+    int64_t live_count, live_bytes;
+    int64_t frame_allocs, frame_bytes, last_frame_allocs, last_frame_bytes, peak_frame_bytes;
+    int64_t histogram[32]; // allocs per pow2 size class
+} watch_tag;
+
+typedef struct watch_entry {
+    void *ptr; // NULL if empty slot
+    int size, site, tag; // site: index into watch_sites[] or -1. tag: index into watch_tags[] or -1
+    int64_t time;
+} watch_entry;
+
+// all tables are open-addressing, linear probing, pow2 sized. SYS_REALLOC'd, so they're not tracked themselves.
+static watch_entry *watch_ptrs; static unsigned watch_ptrs_cap, watch_ptrs_len;
+static unsigned *watch_index; static unsigned watch_index_cap; // site id -> 1 + index into watch_sites[]
+static watch_site *watch_sites; static unsigned watch_sites_len;
+static unsigned *watch_tags_index; static unsigned watch_tags_cap; // fileline -> 1 + index into watch_tags[]
+static watch_tag *watch_tags; static unsigned watch_tags_len;
+static int64_t watch_frames;
+static thread_mutex_t watch_lock;
+static thread_atomic_int_t watch_ready; // memory_once() state. 2 when watch_lock is usable
+static threadlocal int watch_busy;
+
+static unsigned watch_hash_ptr( void *ptr ) {
+    return (unsigned)(((uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull) >> 32);
+}
+static int watch_find_ptr( void *ptr ) {
+    unsigned mask = watch_ptrs_cap - 1;
+    for( unsigned i = watch_hash_ptr(ptr) & mask; watch_ptrs_cap; i = (i + 1) & mask ) {
+        if( watch_ptrs[i].ptr == ptr ) return i;
+        if( !watch_ptrs[i].ptr ) break;
+    }
+    return -1;
+}
+static void watch_insert_ptr( watch_entry e ) {
+    if( (watch_ptrs_len + 1) * 3 >= watch_ptrs_cap * 2 ) { // rehash at 66% load
+        unsigned oldcap = watch_ptrs_cap; watch_entry *old = watch_ptrs;
+        watch_ptrs_cap = oldcap ? oldcap * 2 : 4096;
+        watch_ptrs = (watch_entry*)SYS_REALLOC(0, watch_ptrs_cap * sizeof(watch_entry));
+        memset(watch_ptrs, 0, watch_ptrs_cap * sizeof(watch_entry));
+        watch_ptrs_len = 0;
+        for( unsigned i = 0; i < oldcap; ++i ) if( old[i].ptr ) watch_insert_ptr(old[i]);
+        SYS_REALLOC(old, 0);
+    }
+    unsigned mask = watch_ptrs_cap - 1, i = watch_hash_ptr(e.ptr) & mask;
+    while( watch_ptrs[i].ptr ) i = (i + 1) & mask;
+    watch_ptrs[i] = e;
+    ++watch_ptrs_len;
+}
+static void watch_erase_ptr( unsigned i ) { // backward-shift deletion. no tombstones.
+    unsigned mask = watch_ptrs_cap - 1;
+    for( unsigned j = i; ; ) {
+        j = (j + 1) & mask;
+        if( !watch_ptrs[j].ptr ) break;
+        unsigned k = watch_hash_ptr(watch_ptrs[j].ptr) & mask;
+        if( i <= j ? (i < k && k <= j) : (i < k || k <= j) ) continue;
+        watch_ptrs[i] = watch_ptrs[j];
+        i = j;
+    }
+    watch_ptrs[i].ptr = 0;
+    --watch_ptrs_len;
+}
+static int watch_find_or_add_site( uint64_t id, void **frames, int num_frames ) {
+    if( (watch_sites_len + 1) * 2 >= watch_index_cap ) { // rehash at 50% load
+        SYS_REALLOC(watch_index, 0);
+        watch_index_cap = watch_index_cap ? watch_index_cap * 2 : 1024;
+        watch_index = (unsigned*)SYS_REALLOC(0, watch_index_cap * sizeof(unsigned));
+        memset(watch_index, 0, watch_index_cap * sizeof(unsigned));
+        for( unsigned s = 0; s < watch_sites_len; ++s ) {
+            unsigned i = (unsigned)watch_sites[s].id & (watch_index_cap - 1);
+            while( watch_index[i] ) i = (i + 1) & (watch_index_cap - 1);
+            watch_index[i] = s + 1;
+        }
+    }
+    unsigned mask = watch_index_cap - 1, i = (unsigned)id & mask;
+    for( ; watch_index[i]; i = (i + 1) & mask ) {
+        if( watch_sites[watch_index[i] - 1].id == id ) return watch_index[i] - 1;
+    }
+    if( !(watch_sites_len & (watch_sites_len - 1)) ) { // grow dense array at pow2 lengths
+        watch_sites = (watch_site*)SYS_REALLOC(watch_sites, (watch_sites_len ? watch_sites_len * 2 : 1) * sizeof(watch_site));
+    }
+    watch_site *site = &watch_sites[watch_sites_len];
+    memset(site, 0, sizeof(watch_site));
+    site->id = id;
+    site->num_frames = num_frames;
+    memcpy(site->frames, frames, num_frames * sizeof(void*));
+    return (watch_index[i] = ++watch_sites_len) - 1;
+}
+
+static int watch_find_or_add_tag( const char *fileline ) {
+    unsigned hash = watch_hash_ptr((void*)fileline);
+    if( (watch_tags_len + 1) * 2 >= watch_tags_cap ) { // rehash at 50% load
+        SYS_REALLOC(watch_tags_index, 0);
+        watch_tags_cap = watch_tags_cap ? watch_tags_cap * 2 : 256;
+        watch_tags_index = (unsigned*)SYS_REALLOC(0, watch_tags_cap * sizeof(unsigned));
+        memset(watch_tags_index, 0, watch_tags_cap * sizeof(unsigned));
+        for( unsigned t = 0; t < watch_tags_len; ++t ) {
+            unsigned i = watch_hash_ptr((void*)watch_tags[t].fileline) & (watch_tags_cap - 1);
+            while( watch_tags_index[i] ) i = (i + 1) & (watch_tags_cap - 1);
+            watch_tags_index[i] = t + 1;
         }
     }
+    unsigned mask = watch_tags_cap - 1, i = hash & mask;
+    for( ; watch_tags_index[i]; i = (i + 1) & mask ) {
+        if( watch_tags[watch_tags_index[i] - 1].fileline == fileline ) return watch_tags_index[i] - 1;
+    }
+    if( !(watch_tags_len & (watch_tags_len - 1)) ) { // grow dense array at pow2 lengths
+        watch_tags = (watch_tag*)SYS_REALLOC(watch_tags, (watch_tags_len ? watch_tags_len * 2 : 1) * sizeof(watch_tag));
+    }
+    watch_tag *tag = &watch_tags[watch_tags_len];
+    memset(tag, 0, sizeof(watch_tag));
+    tag->fileline = fileline;
+    const char *basename = strrchr(fileline, '/'); if(!basename) basename = strrchr(fileline, '\\');
+    basename = basename ? basename + 1 : fileline;
+    char *label = (char*)SYS_REALLOC(0, strlen(basename) + 16);
+    sprintf(label, "Alloc.KiB @%s", basename);
+    tag->label = label;
+    return (watch_tags_index[i] = ++watch_tags_len) - 1;
+}
+
+static void watch_untrack( int found ) { // watch_lock must be held
+    watch_entry *e = &watch_ptrs[found];
+    if( e->site >= 0 ) {
+        watch_site *site = &watch_sites[e->site];
+        site->count--, site->bytes -= e->size;
+    }
+    if( e->tag >= 0 ) {
+        watch_tag *tag = &watch_tags[e->tag];
+        tag->frees++, tag->live_count--, tag->live_bytes -= e->size;
+    }
+    watch_erase_ptr(found);
+}
+
+static void watch_report_atexit(void) {
+    watch_report(stderr);
+}
+static void watch_init(void) {
+    thread_mutex_init(&watch_lock);
+#if WITH_LEAK_DETECTOR
+    (atexit)(watch_report_atexit);
+#endif
+}
+static bool watch_inited(void) {
+    return thread_atomic_int_load(&watch_ready) == 2;
+}
+
+void* watch( void *ptr, int sz ) {
+    return watch_at( ptr, sz, NULL );
+}
+void* watch_at( void *ptr, int sz, const char *fileline ) {
+    if( !ptr || watch_busy ) return ptr;
+    ++watch_busy;
+
+    void *frames[WATCH_FRAMES + 2];
+    int num_frames = 0;
+    uint64_t id = 14695981039346656037ULL; // fnv1a
+#if WITH_LEAK_DETECTOR
+    // capture callstack. skip watch_at() and callstack_frames() themselves
+    int callstack_frames( void **frames, int maxframes );
+    num_frames = callstack_frames(frames, WATCH_FRAMES + 2) - 2;
+    if( num_frames < 0 ) num_frames = 0;
+    for( int i = 0; i < num_frames; ++i ) id = (id ^ (uint64_t)(uintptr_t)frames[2+i]) * 0x100000001b3ULL;
+#endif
+
+    memory_once(&watch_ready, watch_init);
+    thread_mutex_lock(&watch_lock);
+
+        int found = watch_find_ptr(ptr);
+        if( found >= 0 ) { // already watched (ie, realloc'd in place and not forgotten)
+            watch_untrack(found);
+        }
+
+        watch_entry e = { ptr, sz, -1, -1, (int64_t)time(0) };
+#if WITH_LEAK_DETECTOR
+        e.site = watch_find_or_add_site(id, frames + 2, num_frames);
+        watch_sites[e.site].count++, watch_sites[e.site].bytes += sz;
+#endif
+#if WITH_ALLOC_PROFILER
+        if( fileline ) {
+            int bucket = 0; while( bucket < 31 && (1ull << bucket) < (unsigned)sz ) ++bucket;
+            e.tag = watch_find_or_add_tag(fileline);
+            watch_tag *tag = &watch_tags[e.tag];
+            tag->allocs++, tag->bytes += sz;
+            tag->live_count++, tag->live_bytes += sz;
+            tag->frame_allocs++, tag->frame_bytes += sz;
+            tag->histogram[bucket]++;
+        }
+#endif
+        if( e.site >= 0 || e.tag >= 0 ) watch_insert_ptr(e);
+
+    thread_mutex_unlock(&watch_lock);
+    --watch_busy;
     return ptr;
 }
 void* forget( void *ptr ) {
-    if( ptr ) {
-        char buf[256];
-        sprintf(buf, "%p.mem", ptr);
-        unlink(buf);
-    }
+    if( !ptr || !watch_inited() || watch_busy ) return ptr;
+    thread_mutex_lock(&watch_lock);
+
+        int found = watch_find_ptr(ptr);
+        if( found >= 0 ) watch_untrack(found);
+
+    thread_mutex_unlock(&watch_lock);
     return ptr;
 }
 
+static int watch_frame_sort( const void *a, const void *b ) {
+    int64_t x = watch_tags[*(const int*)a].last_frame_bytes, y = watch_tags[*(const int*)b].last_frame_bytes;
+    return (x < y) - (x > y);
+}
+void watch_frame() {
+    if( !watch_inited() ) return;
+    ++watch_busy;
+
+    enum { TOP = 8 }; // callsites shown in profiler
+    int top[TOP], num = 0;
+    int64_t allocs = 0, bytes = 0, live = 0;
+
+    thread_mutex_lock(&watch_lock);
+        for( unsigned t = 0; t < watch_tags_len; ++t ) {
+            watch_tag *tag = &watch_tags[t];
+            tag->last_frame_allocs = tag->frame_allocs;
+            tag->last_frame_bytes = tag->frame_bytes;
+            if( tag->peak_frame_bytes < tag->frame_bytes ) tag->peak_frame_bytes = tag->frame_bytes;
+            tag->frame_allocs = tag->frame_bytes = 0;
+            allocs += tag->last_frame_allocs, bytes += tag->last_frame_bytes, live += tag->live_bytes;
+            if( !tag->last_frame_allocs ) continue;
+            // keep TOP churning callsites
+            if( num < TOP ) top[num++] = t;
+            else if( watch_tags[top[TOP-1]].last_frame_bytes < tag->last_frame_bytes ) top[TOP-1] = t;
+            else continue;
+            qsort(top, num, sizeof(int), watch_frame_sort);
+        }
+        ++watch_frames;
+
+        if( allocs ) {
+            profile_incstat("Alloc.Frame.Count", allocs);
+            profile_incstat("Alloc.Frame.KiB", bytes / 1024.0);
+        }
+        profile_incstat("Alloc.Live.MiB", live / 1024.0 / 1024.0);
+        for( int i = 0; i < num; ++i ) {
+            profile_incstat(watch_tags[top[i]].label, watch_tags[top[i]].last_frame_bytes / 1024.0);
+        }
+    thread_mutex_unlock(&watch_lock);
+
+    --watch_busy;
+}
+
+bool watch_csv( const char *filename ) {
+    if( !watch_inited() ) return false;
+    FILE *fp = fopen(filename, "wb");
+    if( !fp ) return false;
+    ++watch_busy;
+
+    fprintf(fp, "callsite,allocs,frees,bytes,live_count,live_bytes,allocs_per_frame,bytes_per_frame,last_frame_allocs,last_frame_bytes,peak_frame_bytes");
+    for( int b = 0; b < 32; ++b ) fprintf(fp, ",size<=%llu", 1ull << b);
+    fprintf(fp, "\n");
+
+    thread_mutex_lock(&watch_lock);
+        double frames = watch_frames ? watch_frames : 1;
+        for( unsigned t = 0; t < watch_tags_len; ++t ) {
+            watch_tag *tag = &watch_tags[t];
+            fprintf(fp, "\"%s\",%lld,%lld,%lld,%lld,%lld,%.2f,%.2f,%lld,%lld,%lld", tag->fileline,
+                (long long)tag->allocs, (long long)tag->frees, (long long)tag->bytes,
+                (long long)tag->live_count, (long long)tag->live_bytes,
+                tag->allocs / frames, tag->bytes / frames,
+                (long long)tag->last_frame_allocs, (long long)tag->last_frame_bytes, (long long)tag->peak_frame_bytes);
+            for( int b = 0; b < 32; ++b ) fprintf(fp, ",%lld", (long long)tag->histogram[b]);
+            fprintf(fp, "\n");
+        }
+    thread_mutex_unlock(&watch_lock);
+
+    fclose(fp);
+    --watch_busy;
+    return true;
+}
+
+static FILE *watch_report_fp;
+static int watch_report_line( const char *line ) {
+    fprintf(watch_report_fp, "\t%s\n", line);
+    return 1;
+}
+static int watch_report_sort( const void *a, const void *b ) {
+    int64_t x = ((const watch_site*)a)->bytes, y = ((const watch_site*)b)->bytes;
+    return (x < y) - (x > y);
+}
+void watch_report( FILE *fp ) {
+    if( !watch_inited() || !fp ) return;
+    ++watch_busy;
+
+    // snapshot live sites, so symbols can be resolved with lock released
+    thread_mutex_lock(&watch_lock);
+        int num = 0;
+        int64_t now = time(0), total_count = 0, total_bytes = 0;
+        watch_site *sites = (watch_site*)SYS_REALLOC(0, (watch_sites_len + 1) * sizeof(watch_site));
+        int64_t *oldest = (int64_t*)SYS_REALLOC(0, (watch_sites_len + 1) * sizeof(int64_t));
+        for( unsigned s = 0; s < watch_sites_len; ++s ) oldest[s] = now;
+        for( unsigned i = 0; i < watch_ptrs_cap; ++i ) {
+            int site = watch_ptrs[i].ptr ? watch_ptrs[i].site : -1; // untracked by leak detector (profiler tag only)
+            if( site >= 0 && watch_ptrs[i].time < oldest[site] ) oldest[site] = watch_ptrs[i].time;
+        }
+        for( unsigned s = 0; s < watch_sites_len; ++s ) {
+            if( watch_sites[s].count <= 0 ) continue;
+            sites[num] = watch_sites[s];
+            sites[num].id = oldest[s]; // reuse id field as oldest timestamp
+            total_count += sites[num].count, total_bytes += sites[num].bytes;
+            ++num;
+        }
+        SYS_REALLOC(oldest, 0);
+    thread_mutex_unlock(&watch_lock);
+
+    if( num ) {
+        qsort(sites, num, sizeof(watch_site), watch_report_sort);
+        fprintf(fp, "Memleaks: %lld bytes in %lld allocations, from %d callsites. Built %s %s\n", (long long)total_bytes, (long long)total_count, num, __DATE__, __TIME__);
+        for( int s = 0; s < num; ++s ) {
+            fprintf(fp, "%lld bytes in %lld allocations (oldest: %llds ago)\n", (long long)sites[s].bytes, (long long)sites[s].count, (long long)(now - (int64_t)sites[s].id));
+            void callstack_symbols( void **frames, int num, int (*yield)(const char *) );
+            watch_report_fp = fp;
+            callstack_symbols( sites[s].frames, sites[s].num_frames, watch_report_line );
+        }
+        fflush(fp);
+    }
+
+    SYS_REALLOC(sites, 0);
+    --watch_busy;
+}
+
+// demo -----------------------------------------------------------------------
+
+#ifdef MEMORY_DEMO
+// multi-threaded alloc/free benchmark: system realloc() vs trealloc().
+// threads swap blocks thru a shared slot table, so roughly (N-1)/N of all frees are cross-thread.
+
+enum { BENCH_SLOTS = 64 * 1024, BENCH_OPS = 2000000 };
+static void* volatile bench_slots[BENCH_SLOTS];
+static void* (*bench_realloc)(void*, size_t);
+
+static int bench_thread( void *arg ) {
+    uint64_t seed = (uintptr_t)arg * 0x9E3779B97F4A7C15ull + 1;
+    for( int i = 0; i < BENCH_OPS; ++i ) {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17; // xorshift64
+        size_t sz = (seed >> 32) % 100 < 95 ? 16 + (seed >> 40) % 512 : 4096 + (seed >> 40) % 65536;
+        char *ptr = (char*)bench_realloc(0, sz); ptr[0] = ptr[sz-1] = 1;
+        void *old = tblock_xchg(&bench_slots[seed % BENCH_SLOTS], ptr);
+        if( old ) bench_realloc(old, 0);
+    }
+    return 0;
+}
+static double bench_time() { // wall clock. time_ss() requires a window
+#ifdef _WIN32
+    LARGE_INTEGER f, c; QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / f.QuadPart;
+#else
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+static double bench( void* (*fn)(void*, size_t), int threads ) {
+    thread_ptr_t t[64];
+    bench_realloc = fn;
+    double time = -bench_time();
+    for( int i = 0; i < threads; ++i ) t[i] = thread_create(bench_thread, (void*)(uintptr_t)(i + 1), 0, 0);
+    for( int i = 0; i < threads; ++i ) thread_join(t[i]), thread_destroy(t[i]);
+    for( int i = 0; i < BENCH_SLOTS; ++i ) fn(bench_slots[i], 0), bench_slots[i] = 0;
+    return time + bench_time();
+}
+int main() {
+    printf("%d ops per thread, 95%% small (16..528 bytes), 5%% large (4..68 KiB)\n", BENCH_OPS);
+    for( int threads = 1; threads <= 8; threads *= 2 ) {
+        double sys = bench(realloc, threads), ours = bench(trealloc, threads);
+        printf("%d threads: realloc %.3fs, trealloc %.3fs (x%.2f)\n", threads, sys, ours, sys / ours);
+    }
+    // xsize() semantics
+    for( size_t sz = 1; sz < 256 * 1024; sz = sz * 3 + 1 ) {
+        void *ptr = trealloc(0, sz);
+        assert( tsize(ptr) >= sz );
+        ptr = trealloc(ptr, sz * 2);
+        assert( tsize(ptr) >= sz * 2 );
+        trealloc(ptr, 0);
+    }
+    puts("ok");
+}
+#define main main__
+#endif // MEMORY_DEMO
+
 #endif
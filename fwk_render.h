@@ -98,6 +98,7 @@ texture_t texture(const char* filename, int flags);
 texture_t texture_from_mem(const char* ptr, int len, int flags);
 texture_t texture_create(unsigned w, unsigned h, unsigned n, void *pixels, int flags);
 texture_t texture_checker();
+int       texture_async(texture_t *t, const char *filename, int flags, int priority); // request id, see vfs_cancel(). *t gets filled once loaded
 void      texture_destroy(texture_t *t);
 // textureLod(filename, dir, lod);
 //void texture_add_loader( int(*loader)(const char *filename, int *w, int *h, int *bpp, int reqbpp, int flags) );
@@ -216,6 +217,7 @@ typedef struct model_t {
 
 model_t  model(const char *filename, int flags);
 model_t  model_from_mem(const void *mem, int sz, int flags);
+int      model_async(model_t *m, const char *filename, int flags, int priority); // request id, see vfs_cancel(). *m gets filled once loaded
 float    model_animate(model_t, float curframe);
 float    model_animate_clip(model_t, float curframe, int minframe, int maxframe, bool loop);
 aabb     model_aabb(model_t, mat44 transform);
@@ -438,6 +440,17 @@ GLuint shader_compile( GLenum type, const char *source ) {
     return shader;
 }
 
+static map(uint64_t, int) shader_uniforms; // (program << 32 | interned name) -> uniform location
+
+static void shader_forget_(unsigned program) { // drops cached uniform locations. gl recycles ids of deleted programs
+    if( shader_uniforms ) {
+        array(uint64_t) keys = 0;
+        for each_map(shader_uniforms, uint64_t, k, int, v) if( (k >> 32) == program ) array_push(keys, k);
+        for( int i = 0; i < array_count(keys); ++i ) map_erase(shader_uniforms, keys[i]);
+        array_free(keys);
+    }
+}
+
 unsigned shader(const char *vs, const char *fs, const char *attribs, const char *fragcolor) {
     PRINTF("Compiling shader\n");
 
@@ -495,20 +508,28 @@ unsigned shader(const char *vs, const char *fs, const char *attribs, const char
         shader_print(vs);
         shader_print(fs);
 #endif
+
+        shader_forget_(program); // in case its id was deleted behind shader_destroy()'s back
     }
 
     return program;
 }
 
 void shader_destroy(unsigned program){
+    shader_forget_(program);
     glDeleteProgram(program);
 }
 
 unsigned last_shader = -1;
 static
 int shader_uniform(const char *name) {
+    if( !shader_uniforms ) map_init(shader_uniforms, less_u64, hash_64);
+    uint64_t key = ((uint64_t)last_shader << 32) | intern(name);
+    int *found = map_find(shader_uniforms, key);
+    if( found ) return *found;
     int ret = glGetUniformLocation(last_shader, name);
     if( ret < 0 ) fprintf(stderr, "cannot find uniform '%s' in shader program %d\n", name, (int)last_shader );
+    map_insert(shader_uniforms, key, ret);
     return ret;
 }
 unsigned shader_get_active() { return last_shader; }
@@ -549,13 +570,26 @@ image_t image_create(int x, int y, int flags) {
 image_t image_from_mem(const char *data, int size, int flags) {
     image_t img = {0};
     if( data && size ) {
-        stbi_set_flip_vertically_on_load(flags & IMAGE_FLIP ? 1 : 0);
+        stbi_set_flip_vertically_on_load_thread(flags & IMAGE_FLIP ? 1 : 0); // async loaders decode from other threads
 
         int n = 0;
         if(flags & IMAGE_R) n = 1;
         if(flags & IMAGE_RG) n = 2;
         if(flags & IMAGE_RGB) n = 3;
         if(flags & IMAGE_RGBA) n = 4;
+
+        // texels decoded by a previous run: { w, h, n, 0 } header, then pixels
+        uint64_t key = file_cache_key(data, size, stringf("image %#x", flags & (IMAGE_R|IMAGE_RG|IMAGE_RGB|IMAGE_RGBA|IMAGE_FLIP)));
+        int len; const unsigned *cached = (const unsigned *)file_cache_load(key, &len);
+        if( cached && len > 16 && (uint64_t)cached[0] * cached[1] * cached[2] == len - 16 ) {
+            img.x = cached[0], img.y = cached[1], img.n = cached[2];
+            img.pixels = malloc(len - 16); // stbi allocator, as image_destroy() expects
+            memcpy(img.pixels, cached + 4, len - 16);
+            file_cache_unload((const char *)cached, len);
+            return img;
+        }
+        if( cached ) file_cache_unload((const char *)cached, len);
+
         img.pixels = stbi_load_from_memory(data, size, &img.x,&img.y,&img.n, n);
         if( img.pixels ) {
             PRINTF("Loaded image (%dx%d %.*s->%.*s)\n",img.w,img.h,img.n,"RGBA",n?n:img.n,"RGBA");
@@ -563,22 +597,27 @@ image_t image_from_mem(const char *data, int size, int flags) {
             // PANIC("Error loading image (%s)\n", pathfile);
         }
         img.n = n ? n : img.n;
+
+        int bytes = img.pixels ? img.x * img.y * img.n : 0;
+        if( bytes >= FILE_CACHE_MIN ) {
+            unsigned *blob = REALLOC(0, 16 + bytes);
+            blob[0] = img.x, blob[1] = img.y, blob[2] = img.n, blob[3] = 0;
+            memcpy(blob + 4, img.pixels, bytes);
+            file_cache_save(key, blob, 16 + bytes);
+            REALLOC(blob, 0);
+        }
     }
     return img;
 }
 
 image_t image(const char *pathfile, int flags) {
+    // decode straight from vfs memory (cached, do not free). probe common extensions if missing
+    static const char *exts[] = { "", ".png", ".jpg", ".tga", ".jpg.png", ".tga.png", ".png.jpg", ".tga.jpg" };
     int size = 0;
-    char *data = file_load(file_find(pathfile/*stringf("%s", pathfile)*/), &size);
-#if 1
-    if( !size ) data = file_load(file_find(stringf("%s.png",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.jpg",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.tga",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.jpg.png",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.tga.png",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.png.jpg",pathfile)), &size);
-    if( !size ) data = file_load(file_find(stringf("%s.tga.jpg",pathfile)), &size);
-#endif
+    char *data = 0;
+    for( int i = 0; i < countof(exts) && !size; ++i ) {
+        data = vfs_load(stringf("%s%s", pathfile, exts[i]), &size);
+    }
     return image_from_mem(data, size, flags);
 }
 
@@ -719,18 +758,73 @@ texture_t texture_from_mem(const char *ptr, int len, int flags) {
     return texture_checker();
 }
 
+#if WITH_HOTRELOAD
+// textures loaded from files get re-uploaded in place when recooked, so handles stay valid
+struct texture_source {
+    texture_t t;
+    unsigned path; // atom. gl ids get recycled after texture_destroy()
+};
+static map(unsigned, struct texture_source) texture_sources; // gl id -> texture
+static void texture_reload(const char *pathfile, void *userdata) {
+    struct texture_source *src = texture_sources ? map_find(texture_sources, (unsigned)(uintptr_t)userdata) : 0;
+    if( !src || src->path != intern(pathfile) ) return;
+    image_t img = image(pathfile, src->t.flags);
+    if( img.pixels ) {
+        texture_update(&src->t, img.x, img.y, img.n, img.pixels, src->t.flags);
+        image_destroy(&img);
+    }
+}
+#endif
+
 texture_t texture(const char *pathfile, int flags) {
     // PRINTF("Loading file %s\n", pathfile);
     image_t img = image(pathfile, flags);
     if( img.pixels ) {
         texture_t t = texture_create(img.x, img.y, img.n, img.pixels, flags);
         image_destroy(&img);
+#if WITH_HOTRELOAD
+        struct texture_source src = { t, intern(pathfile) };
+        src.t.flags = flags;
+        if( !texture_sources ) map_init(texture_sources, less_int, hash_int);
+        if( map_find(texture_sources, t.id) ) map_erase(texture_sources, t.id);
+        map_insert(texture_sources, t.id, src);
+        vfs_reload(pathfile, texture_reload, (void*)(uintptr_t)t.id);
+#endif
         return t;
     }
     return texture_checker();
 }
 
+struct texture_async_t {
+    texture_t *t;
+    int flags;
+};
+static void* texture_async_decode(vfs_request *r) { // worker thread
+    struct texture_async_t *ta = (struct texture_async_t *)r->userdata;
+    image_t *img = REALLOC(0, sizeof(image_t));
+    *img = image_from_mem(r->data, r->size, ta->flags);
+    return img;
+}
+static void texture_async_finalize(vfs_request *r) { // main thread
+    struct texture_async_t *ta = (struct texture_async_t *)r->userdata;
+    image_t *img = (image_t *)r->decoded;
+    if( !r->cancelled ) {
+        *ta->t = img && img->pixels ? texture_create(img->x, img->y, img->n, img->pixels, ta->flags) : texture_checker();
+    }
+    if( img ) image_destroy(img), REALLOC(img, 0);
+    REALLOC(ta, 0);
+}
+int texture_async(texture_t *t, const char *pathfile, int flags, int priority) {
+    struct texture_async_t *ta = REALLOC(0, sizeof(struct texture_async_t));
+    ta->t = t;
+    ta->flags = flags;
+    return vfs_load_async(pathfile, priority, texture_async_decode, texture_async_finalize, ta);
+}
+
 void texture_destroy( texture_t *t ) {
+#if WITH_HOTRELOAD
+    if( t->id && texture_sources && map_find(texture_sources, t->id) ) map_erase(texture_sources, t->id); // its reloader becomes a no-op
+#endif
     if(t->id) glDeleteTextures(1, &t->id);
     t->id = 0;
 }
@@ -1004,6 +1098,8 @@ static void sprite_rebuild_meshes() {
             int index = 0;
             array_clear(sprite_indices);
             array_clear(sprite_vertices);
+            array_reserve(sprite_indices, 2 * array_count(bt->sprites));
+            array_reserve(sprite_vertices, 4 * array_count(bt->sprites));
 
             array_foreach_ptr(bt->sprites, sprite_t,it ) {
                 float x0 = it->ox - it->cellw/2, x3 = x0 + it->cellw;
@@ -1031,18 +1127,24 @@ static void sprite_rebuild_meshes() {
                 vec2 uv2 = vec2(vx, vy);
                 vec2 uv3 = vec2(vx, uy);
 
-                array_push( sprite_vertices, sprite_vertex(v0, uv0, it->rgba) ); // Vertex 0 (A)
-                array_push( sprite_vertices, sprite_vertex(v1, uv1, it->rgba) ); // Vertex 1 (B)
-                array_push( sprite_vertices, sprite_vertex(v2, uv2, it->rgba) ); // Vertex 2 (C)
-                array_push( sprite_vertices, sprite_vertex(v3, uv3, it->rgba) ); // Vertex 3 (D)
+                sprite_vertex quad[4] = {
+                    sprite_vertex(v0, uv0, it->rgba), // Vertex 0 (A)
+                    sprite_vertex(v1, uv1, it->rgba), // Vertex 1 (B)
+                    sprite_vertex(v2, uv2, it->rgba), // Vertex 2 (C)
+                    sprite_vertex(v3, uv3, it->rgba), // Vertex 3 (D)
+                };
+                array_push_n( sprite_vertices, quad, 4 );
 
                 //      A--B                  A               A-B
                 // quad |  | becomes triangle |\  and triangle \|
                 //      D--C                  D-C               C
                 GLuint A = (index+0), B = (index+1), C = (index+2), D = (index+3); index += 4;
 
-                array_push( sprite_indices, sprite_index(C, D, A) ); // Triangle 1
-                array_push( sprite_indices, sprite_index(C, A, B) ); // Triangle 2
+                sprite_index tris[2] = {
+                    sprite_index(C, D, A), // Triangle 1
+                    sprite_index(C, A, B), // Triangle 2
+                };
+                array_push_n( sprite_indices, tris, 2 );
             }
 
             mesh_upgrade(&bt->mesh, "p3 t2 c4b", 0,array_count(sprite_vertices),sprite_vertices, 3*array_count(sprite_indices),sprite_indices, MESH_STATIC);
@@ -1360,7 +1462,7 @@ int skybox_pop_state(skybox_t *sky) {
     return 0;
 }
 void skybox_destroy(skybox_t *sky) {
-    glDeleteProgram(sky->program);
+    shader_destroy(sky->program);
     cubemap_destroy(&sky->cubemap);
     mesh_destroy(&sky->geometry);
 }
@@ -1715,6 +1817,8 @@ char* postfx_name(postfx *fx, int slot) {
     return fx->pass[ slot & 63 ].name;
 }
 
+static bool postfx__compile( passfx *p, const char *fs );
+
 bool postfx_load_from_mem( postfx *fx, const char *name, const char *fs ) {
     if(!fs || !fs[0]) PANIC("!invalid fragment shader");
 
@@ -1723,10 +1827,16 @@ bool postfx_load_from_mem( postfx *fx, const char *name, const char *fs ) {
     passfx *p = &fx->pass[ slot & 63 ];
     p->name = STRDUP(name);
 
+    return postfx__compile(p, fs);
+}
+
+static
+bool postfx__compile( passfx *p, const char *fs ) {
     const char *vs = fullscreen_quad_vertex_shader(0);
 
     // patch fragment
-    char *fs2 = (char*)CALLOC(1, 64*1024);
+    uint64_t marker = stack_push();
+    char *fs2 = (char*)stack(64*1024); fs2[0] = '\0';
     strcat(fs2,
         ""
         "#define texture2D texture\n"
@@ -1759,7 +1869,7 @@ bool postfx_load_from_mem( postfx *fx, const char *name, const char *fs ) {
 
     p->program = shader(vs, fs2, "vtexcoord", "fragColor" );
 
-    FREE(fs2);
+    stack_pop(marker);
 
     glUseProgram(p->program); // needed?
 
@@ -1945,7 +2055,20 @@ void fx_load_from_mem(const char *nameid, const char *content) {
     ONCE postfx_create(&fx, 0);
     postfx_load_from_mem(&fx, nameid, content);
 }
+#if WITH_HOTRELOAD
+static void fx_reload(const char *file, void *userdata) { // recompiles in place, so pass numbers stay the same
+    passfx *p = &fx.pass[ (uintptr_t)userdata & 63 ];
+    const char *fs = vfs_read(file);
+    if( !fs || !fs[0] ) return;
+    shader_destroy(p->program);
+    glDeleteVertexArrays(1, &p->m.vao);
+    postfx__compile(p, fs);
+}
+#endif
 void fx_load(const char *file) {
+#if WITH_HOTRELOAD
+    vfs_reload(file, fx_reload, (void*)(uintptr_t)fx.num_loaded);
+#endif
     postfx_load_from_mem(&fx, file_name(file), vfs_read(file));
 }
 void fx_begin() {
@@ -2121,7 +2244,7 @@ typedef struct iqm_t {
 #define bounds (q->bounds)
 
 static
-bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr) {
+bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr, uint64_t key) {
     if(meshdata) return false;
 
     lil32p(&buf[hdr->ofs_vertexarrays], hdr->num_vertexarrays*sizeof(struct iqmvertexarray)/sizeof(uint32_t));
@@ -2185,8 +2308,13 @@ bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr) {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, hdr->num_triangles*sizeof(struct iqmtriangle), tris, GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    iqm_vertex *verts = CALLOC(hdr->num_vertexes, sizeof(iqm_vertex));
-    for(int i = 0; i < (int)hdr->num_vertexes; i++) {
+    // interleaved vertices from a previous run, if any. uploaded straight from the mapping
+    int cached = 0;
+    const char *blob = file_cache_load(key, &cached);
+    if( blob && cached != hdr->num_vertexes*sizeof(iqm_vertex) ) file_cache_unload(blob, cached), blob = 0;
+
+    iqm_vertex *verts = blob ? (iqm_vertex *)blob : CALLOC(hdr->num_vertexes, sizeof(iqm_vertex));
+    if( !blob ) for(int i = 0; i < (int)hdr->num_vertexes; i++) {
         iqm_vertex *v = &verts[i];
         if(inposition) memcpy(v->position, &inposition[i*3], sizeof(v->position));
         if(innormal) memcpy(v->normal, &innormal[i*3], sizeof(v->normal));
@@ -2208,7 +2336,8 @@ bool model_load_meshes(iqm_t *q, const struct iqmheader *hdr) {
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, hdr->num_vertexes*sizeof(iqm_vertex), verts, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    FREE(verts);
+    if( blob ) file_cache_unload(blob, cached);
+    else file_cache_save(key, verts, hdr->num_vertexes*sizeof(iqm_vertex)), FREE(verts);
 
     const char *str = hdr->ofs_text ? (char *)&buf[hdr->ofs_text] : "";
     for(int i = 0; i < (int)hdr->num_meshes; i++) {
@@ -2313,7 +2442,7 @@ bool model_load_textures(iqm_t *q, const struct iqmheader *hdr) {
         strcut(material_name, "unknown+");
         strcut(material_name, "+unknown");
 
-        textures[i] = texture( file_find(material_name), 0 ).id;
+        textures[i] = texture( material_name, 0 ).id;
         #endif
 
         if( textures[i] != texture_checker().id) {
@@ -2330,9 +2459,24 @@ bool model_load_textures(iqm_t *q, const struct iqmheader *hdr) {
 
 model_t model(const char *filename, int flags) {
     int len;  // vfs_pushd(filedir(filename))
-    char *ptr = vfs_load(filename, &len); // + vfs_popd
+    const char *ptr = vfs_map(filename, &len); // + vfs_popd
     return model_from_mem( ptr, len, flags );
 }
+struct model_async_t {
+    model_t *m;
+    int flags;
+};
+static void model_async_finalize(vfs_request *r) { // main thread. parsing is bound to gl buffer creation, so only i/o runs async
+    struct model_async_t *ma = (struct model_async_t *)r->userdata;
+    if( !r->cancelled ) *ma->m = model_from_mem(r->data, r->size, ma->flags);
+    REALLOC(ma, 0);
+}
+int model_async(model_t *m, const char *filename, int flags, int priority) {
+    struct model_async_t *ma = REALLOC(0, sizeof(struct model_async_t));
+    ma->m = m;
+    ma->flags = flags;
+    return vfs_load_async(filename, priority, NULL, model_async_finalize, ma);
+}
 model_t model_from_mem(const void *mem, int len, int flags) {
     const char *ptr = (const char *)mem;
     static int shaderprog = -1;
@@ -2405,7 +2549,8 @@ model_t model_from_mem(const void *mem, int len, int flags) {
                 buf = CALLOC(hdr.filesize, sizeof(uint8_t));
                 memcpy(buf + sizeof(hdr), ptr, hdr.filesize - sizeof(hdr));
                 error = 0;
-                if( hdr.num_meshes > 0 && !(flags & MODEL_NO_MESHES) )     error |= !model_load_meshes(q, &hdr);
+                uint64_t key = file_cache_key(mem, len, stringf("iqm vertex %d", (int)sizeof(iqm_vertex)));
+                if( hdr.num_meshes > 0 && !(flags & MODEL_NO_MESHES) )     error |= !model_load_meshes(q, &hdr, key);
                 if( hdr.num_meshes > 0 && !(flags & MODEL_NO_TEXTURES) )   error |= !model_load_textures(q, &hdr);
                 if( hdr.num_anims  > 0 && !(flags & MODEL_NO_ANIMATIONS) ) error |= !model_load_anims(q, &hdr);
                 if( buf != meshdata && buf != animdata ) FREE(buf);
@@ -115,20 +115,20 @@ void ddraw_flush() {
     for( int i = 0; i < 3; ++i ) { // [0] thin, [1] thick, [2] points
         GLenum mode = i < 2 ? GL_LINES : GL_POINTS;
         glLineWidth(i == 1 ? 1 : 0.3); // 0.625);
-        for each_map(dd_lists[i], unsigned, rgb, array(vec3), list) {
-            int count = array_count(list);
+        for each_map_ptr(dd_lists[i], unsigned, rgb, array(vec3), list) {
+            int count = array_count(*list);
             if(!count) continue;
                 // color
-                vec3 rgbf = {((rgb>>16)&255)/255.f,((rgb>>8)&255)/255.f,((rgb>>0)&255)/255.f};
+                vec3 rgbf = {((*rgb>>16)&255)/255.f,((*rgb>>8)&255)/255.f,((*rgb>>0)&255)/255.f};
                 glUniform3fv(dd_u_color, GL_TRUE, &rgbf.x);
                 // config vertex data
-                glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, list, GL_STATIC_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, *list, GL_STATIC_DRAW);
                 glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
                 // feed vertex data
                 glDrawArrays(mode, 0, count);
                 profile_incstat("drawcalls", +1);
                 profile_incstat(i < 2 ? "lines" : "points", count);
-            array_clear(list);
+            array_clear(*list); // keeps capacity for next frame
         }
     }
 
@@ -148,20 +148,20 @@ void ddraw_flush() {
         for( int i = 0; i < 3; ++i ) { // [0] thin, [1] thick, [2] points
             GLenum mode = i < 2 ? GL_LINES : GL_POINTS;
             glLineWidth(i == 1 ? 1 : 0.3); // 0.625);
-            for each_map(dd_lists[i], unsigned, rgb, array(vec3), list) {
-                int count = array_count(list);
+            for each_map_ptr(dd_lists[i], unsigned, rgb, array(vec3), list) {
+                int count = array_count(*list);
                 if(!count) continue;
                     // color
-                    vec3 rgbf = {((rgb>>16)&255)/255.f,((rgb>>8)&255)/255.f,((rgb>>0)&255)/255.f};
+                    vec3 rgbf = {((*rgb>>16)&255)/255.f,((*rgb>>8)&255)/255.f,((*rgb>>0)&255)/255.f};
                     glUniform3fv(dd_u_color, GL_TRUE, &rgbf.x);
                     // config vertex data
-                    glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, list, GL_STATIC_DRAW);
+                    glBufferData(GL_ARRAY_BUFFER, count * 3 * 4, *list, GL_STATIC_DRAW);
                     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
                     // feed vertex data
                     glDrawArrays(mode, 0, count);
                     profile_incstat("drawcalls", +1);
                     profile_incstat(i < 2 ? "lines" : "points", count);
-                array_clear(list);
+                array_clear(*list); // keeps capacity for next frame
             }
         }
     }
@@ -193,8 +193,7 @@ void ddraw_line_thin(vec3 from, vec3 to) { // thin lines
 #else
     array(vec3) *found = map_find_or_add(dd_lists[0], dd_color, 0);
 #endif
-    array_push(*found, from);
-    array_push(*found, to);
+    array_push_n(*found, ((vec3[2]){from, to}), 2);
 }
 void ddraw_line(vec3 from, vec3 to) { // thick lines
 #if 0
@@ -203,8 +202,7 @@ void ddraw_line(vec3 from, vec3 to) { // thick lines
 #else
     array(vec3) *found = map_find_or_add(dd_lists[1], dd_color, 0);
 #endif
-    array_push(*found, from);
-    array_push(*found, to);
+    array_push_n(*found, ((vec3[2]){from, to}), 2);
 }
 void ddraw_line_dash(vec3 from, vec3 to) { // thick lines
     vec3 dist = sub3(to, from); vec3 unit = norm3(dist);
@@ -297,11 +297,13 @@ int scene_merge(const char *source) {
             PRINTF("Scene %d/%d Scale: (%f,%f,%f)\n", i, e, scale.x, scale.y, scale.z);
             PRINTF("Scene %d/%d Swap_ZY: %d\n", i, e, opt_swap_zy );
             PRINTF("Scene %d/%d Flip_UV: %d\n", i, e, opt_flip_uv );
-            model_t m = model_from_mem(vfs_read(mesh_file), vfs_size(mesh_file), 0/*opt_swap_zy*/);
+            int mesh_size = 0; const char *mesh_data = vfs_map(mesh_file, &mesh_size);
+            model_t m = model_from_mem(mesh_data, mesh_size, 0/*opt_swap_zy*/);
             //char *a = archive_read(animation_file);
             object_t *o = scene_spawn();
             object_model(o, m);
-            if( texture_file[0] ) object_diffuse(o, texture_from_mem(vfs_read(texture_file), vfs_size(texture_file), opt_flip_uv ? IMAGE_FLIP : 0) );
+            int texture_size = 0; const char *texture_data = texture_file[0] ? vfs_map(texture_file, &texture_size) : 0;
+            if( texture_file[0] ) object_diffuse(o, texture_from_mem(texture_data, texture_size, opt_flip_uv ? IMAGE_FLIP : 0) );
             object_scale(o, scale);
             object_teleport(o, position);
             object_pivot(o, rotation); // object_rotate(o, rotation);
@@ -84,8 +84,16 @@ void script_run(const char *script) {
     }
 }
 
+#if WITH_HOTRELOAD
+static void script_reload(const char *pathfile, void *userdata) {
+    script_runfile(pathfile); // runs it again, so top-level definitions get replaced
+}
+#endif
 void script_runfile(const char *pathfile) {
     PRINTF( "Loading script '%s'\n", pathfile );
+#if WITH_HOTRELOAD
+    vfs_reload(pathfile, script_reload, NULL);
+#endif
     int loadResult = luaL_loadfile( L, pathfile );
 
     /**/ if( loadResult == LUA_OK ) {
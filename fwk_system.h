@@ -29,6 +29,8 @@ double      sleep_ms(double ms);
 
 char*       callstack( int traces ); // write callstack into a temporary string. do not delete it.
 int         callstackf( FILE *fp, int traces ); // write callstack to file. <0 traces to invert order.
+int         callstack_frames( void **frames, int maxframes ); // capture raw return addresses only. cheap.
+void        callstack_symbols( void **frames, int num, int (*yield)(const char *) ); // resolve previously captured frames.
 
 uint16_t    lil16(uint16_t n); // swap16 as lil
 uint32_t    lil32(uint32_t n); // swap32 as lil
@@ -206,23 +208,19 @@ static int backtrace(void **heap, int num) { return 0; }
 static char **backtrace_symbols(void *const *sym,int num) { return 0; }
 #endif
 
-void trace_cb( int traces, int (*yield)(const char *)) { //$
-    enum { skip = 1 }; /* exclude 1 trace from stack (this function) */
-    enum { maxtraces = 128 };
-
-    int inc = 1;
-    if( traces < 0 ) traces = -traces, inc = -1;
-    if( traces == 0 ) return;
-    if( traces > maxtraces ) traces = maxtraces;
+int callstack_frames( void **frames, int maxframes ) { //$
+    return backtrace( frames, maxframes );
+}
 
-    void *stack[ maxtraces ];
-    traces = backtrace( stack, traces );
+void callstack_symbols( void **stack, int traces, int (*yield)(const char *)) { //$
+    if( traces <= 0 ) return;
     char **symbols = backtrace_symbols( stack, traces );
+    if( !symbols ) return;
 
     char demangled[1024] = "??", buf[1024];
-    int L = 0, B = inc>0 ? skip - 1 : traces, E = inc>0 ? traces : skip - 1;
-    for( int i = B; ( i += inc ) != E; ) {
+    for( int i = 0; i < traces; ++i ) {
 #ifdef __linux__
+        char original[1024]; snprintf(original, sizeof(original), "%s", symbols[i]);
         char *address = strstr( symbols[i], "[" ) + 1; address[strlen(address) - 1] = '\0';
         char *binary = symbols[i]; strstr( symbols[i], "(" )[0] = '\0';
         char command[1024]; sprintf(command, "addr2line -e %s %s", binary, address);
@@ -230,7 +228,7 @@ void trace_cb( int traces, int (*yield)(const char *)) { //$
             fgets(demangled, sizeof(demangled), fp);
             int len = strlen(demangled); while( len > 0 && demangled[len-1] < 32 ) demangled[--len] = 0;
         }
-        symbols[i] = demangled;
+        symbols[i] = demangled[0] == '?' ? original : demangled; // addr2line fails on PIE addresses
 #elif __APPLE__
         struct Dl_info info;
         if( dladdr(stack[i], &info) && info.dli_sname ) {
@@ -241,12 +239,38 @@ void trace_cb( int traces, int (*yield)(const char *)) { //$
             FREE( dmgbuf );
         }
 #endif
-        sprintf(buf, "%03d: %#016p %s", ++L, stack[i], symbols[i]);
-        //sprintf(buf, "%03d: %s", ++L, symbols[i]);
+        sprintf(buf, "%03d: %#016p %s", i+1, stack[i], symbols[i]);
+        //sprintf(buf, "%03d: %s", i+1, symbols[i]);
         if( yield(buf) < 0 ) break;
     }
 
-    SYS_REALLOC( symbols, 0 );
+#ifdef _WIN32
+    SYS_REALLOC( symbols, 0 ); // allocated by our own backtrace_symbols() above
+#else
+    free( symbols ); // allocated by libc, SYS_REALLOC might be a different allocator
+#endif
+}
+
+void trace_cb( int traces, int (*yield)(const char *)) { //$
+    enum { skip = 1 }; /* exclude 1 trace from stack (this function) */
+    enum { maxtraces = 128 };
+
+    int inc = 1;
+    if( traces < 0 ) traces = -traces, inc = -1;
+    if( traces == 0 ) return;
+    if( traces > maxtraces ) traces = maxtraces;
+
+    void *stack[ maxtraces ];
+    traces = backtrace( stack, traces );
+    if( traces <= skip ) return;
+
+    if( inc < 0 ) { // invert order
+        for( int i = skip, j = traces - 1; i < j; ++i, --j ) {
+            void *swap = stack[i]; stack[i] = stack[j]; stack[j] = swap;
+        }
+    }
+
+    callstack_symbols( stack + skip, traces - skip, yield );
 }
 
 static threadlocal char *trace_strbuf[128] = {0};
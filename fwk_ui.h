@@ -65,7 +65,8 @@ void ui_create() {
 #ifdef _WIN32
         struct nk_font *arial = nk_font_atlas_add_from_file(atlas, stringf("%s/fonts/arial.ttf",getenv("windir")), 14.5, 0); last = arial ? arial : last;
 #else
-        struct nk_font *arial = nk_font_atlas_add_from_file(atlas, file_find("LiberationSans-Regular.ttf"), 14.5, 0); last = arial ? arial : last;
+        int ttf_len; char *ttf = vfs_load("LiberationSans-Regular.ttf", &ttf_len); // atlas keeps its own copy
+        struct nk_font *arial = ttf ? nk_font_atlas_add_from_memory(atlas, ttf, ttf_len, 14.5, 0) : 0; last = arial ? arial : last;
 #endif
         /*struct nk_font *droid = nk_font_atlas_add_from_file(atlas, "nuklear/extra_font/DroidSans.ttf", 14, 0); last = droid ? droid : last; */
         /*struct nk_font *roboto = nk_font_atlas_add_from_file(atlas, "nuklear/extra_font/Roboto-Regular.ttf", 16, 0); last = roboto ? roboto : last; */
@@ -38,6 +38,8 @@ struct video_t {
     // rgb
     void *surface;
     texture_t texture;
+    // source, if played from mounted archives
+    void *data;
 };
 
 static void mpeg_update_texture(GLuint unit, GLuint texture, plm_plane_t *plane) {
@@ -65,8 +67,14 @@ static void mpeg_audio_callback(plm_t *plm, plm_samples_t *samples, void *user)
 }
 
 video_t* video( const char *filename, int flags ) {
-    plm_t* plm = plm_create_with_filename( filename );
+    // files not found on disk get played from mounted archives. copied, as cached views may get evicted while playing
+    int len = 0;
+    const char *view = file_size(filename) ? NULL : vfs_map(filename, &len);
+    void *data = view ? memcpy(REALLOC(0, len), view, len) : NULL;
+
+    plm_t* plm = data ? plm_create_with_memory( data, len, 0 ) : plm_create_with_filename( filename );
     if ( !plm ) {
+        REALLOC(data, 0);
         PANIC( "!Cannot open '%s' file for reading\n", filename );
         return 0;
     }
@@ -90,6 +98,7 @@ video_t* video( const char *filename, int flags ) {
     p->surface = REALLOC( p->surface,  w * h * 3 );
 #endif
     p->plm = plm;
+    p->data = data;
 
     plm_set_loop(plm, false);
     plm_set_audio_enabled(plm, true);
@@ -118,6 +127,7 @@ texture_t* video_decode( video_t *v ) { // decodes next frame, returns associate
 
 void video_destroy(video_t *v) {
     plm_destroy( v->plm );
+    REALLOC( v->data, 0 );
 
 #if WITH_VIDEO_YCBCR
     texture_destroy(&v->textureY);
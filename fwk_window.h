@@ -237,6 +237,31 @@ int window_swap() {
 
         window_flush();
 
+        // rewind per-frame stack allocator
+        profile_incstat("Stack.Peak.KiB", stack_peak() / 1024.0);
+        stack(-1);
+
+        // close per-frame allocation stats
+        watch_frame();
+
+        // file cache stats
+        int64_t hits, misses, evictions; cache_stats(&hits, &misses, &evictions);
+        profile_incstat("Cache.MiB", cache_bytes() / (1024.0 * 1024.0));
+        profile_incstat("Cache.Hits", hits);
+        profile_incstat("Cache.Misses", misses);
+        profile_incstat("Cache.Evictions", evictions);
+
+        // finalize async loads within budget
+        vfs_async_update(ASYNC_BUDGET_MS);
+        profile_incstat("Async.Pending", vfs_pending());
+
+        // reload assets recooked by the cooker watcher
+        vfs_reload_update();
+
+        // recycle temporary strings
+        profile_incstat("Stringf.Frame.KiB", stringf_volume() / 1024.0);
+        stringf_reset();
+
         glfwPollEvents();
 
         // input_update(); // already hooked!
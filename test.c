@@ -61,8 +61,8 @@ int main() {
     object_t *obj2 = scene_index(1);
 
     // manual spawn & loading
-    model_t m1 = model(file_find("3rd/3rd_assets/models/kgirl/kgirls01.fbx"), 0); //MODEL_NO_ANIMS);
-    texture_t t1 = texture(file_find("3rd/3rd_assets/models/kgirl/g01_texture.png"), TEXTURE_RGB);
+    model_t m1 = model("3rd/3rd_assets/models/kgirl/kgirls01.fbx", 0); //MODEL_NO_ANIMS);
+    texture_t t1 = texture("3rd/3rd_assets/models/kgirl/g01_texture.png", TEXTURE_RGB);
     object_t* obj3 = scene_spawn();
     object_model(obj3, m1);
     object_diffuse(obj3, t1);
@@ -71,10 +71,10 @@ int main() {
     object_pivot(obj3, vec3(180,0,0));
 
     // animated models
-    model_t george = model(file_find("robots/george.fbx"), 0);
-    model_t leela = model(file_find("robots/leela.fbx"), 0);
-    model_t mike = model(file_find("robots/mike.fbx"), 0);
-    model_t stan = model(file_find("robots/stan.fbx"), 0);
+    model_t george = model("robots/george.fbx", 0);
+    model_t leela = model("robots/leela.fbx", 0);
+    model_t mike = model("robots/mike.fbx", 0);
+    model_t stan = model("robots/stan.fbx", 0);
     model_t robots[] = { george, leela, mike, stan };
     for( int i = 0; i < countof(robots); ++i ) {
         // rotation44(kgirls01.pivot, -180,0,0,1); // kgirls01.fbx
@@ -88,8 +88,8 @@ int main() {
     cam.speed = 0.2f;
 
     // audio (both clips & streams)
-    audio_t voice = audio_clip(file_find("coin.wav"));
-    audio_t stream = audio_stream(file_find("wrath_of_the_djinn.xm")); // "larry.mid"
+    audio_t voice = audio_clip("coin.wav");
+    audio_t stream = audio_stream("wrath_of_the_djinn.xm"); // "larry.mid"
     audio_play(voice, 0);
     audio_play(stream, 0);
 
@@ -45,7 +45,7 @@ int main(int argc, char** argv) {
         if( !initialized ) {
             initialized = 1;
             sky = skybox(SKY_DIRS[SKY_DIR], 0);
-            mdl = model(file_find(OBJ_MDLS[OBJ_MDL]), 0); // "p3 n3 t2",
+            mdl = model(OBJ_MDLS[OBJ_MDL], 0); // "p3 n3 t2",
             rotation44(mdl.pivot, 0, 1,0,0);
         }
 
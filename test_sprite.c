@@ -141,9 +141,9 @@ int main(int argc, char **argv) {
     window_create(75.f, 0);
     window_title("FWK - Sprite");
 
-    kids = texture( file_find("spriteSheetExample.png"), TEXTURE_NEAREST );
-    catImage = texture( file_find("cat.png"), TEXTURE_NEAREST );
-    shadowImage = texture( file_find("cat-shadow.png"), TEXTURE_NEAREST );
+    kids = texture( "spriteSheetExample.png", TEXTURE_NEAREST );
+    catImage = texture( "cat.png", TEXTURE_NEAREST );
+    shadowImage = texture( "cat-shadow.png", TEXTURE_NEAREST );
 
     int option_cats = 1;
     NUMSPRITES = argc > 1 ? atoi(argv[1]) : NUMSPRITES; // argvi("--numsprites,-N", "100");
@@ -15,8 +15,8 @@ int main( int argc, const char** argv ) {
     }
 
     // load video, no flags
-    const char *filename = argc < 2 ? file_find("bjork-all-is-full-of-love.mpg") : argv[1];
-    ASSERT(file_size(filename), "cannot find file '%s'", filename);
+    const char *filename = argc < 2 ? "bjork-all-is-full-of-love.mpg" : argv[1];
+    ASSERT(file_size(filename) || vfs_size(filename), "cannot find file '%s'", filename);
 
     video_t *v = video( filename, 0 );
 